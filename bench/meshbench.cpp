@@ -0,0 +1,180 @@
+#include "render/meshoptimizer.h"
+#include "render/model.h"
+#include "render/objreader.h"
+#include "render/vertexwelder.h"
+#include "threadpool.h"
+#include "utils.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace XIV;
+using namespace XIV::Render;
+
+// Times every mesh import path against the same OBJ files and checks they agree.
+// Usage: XIVMeshBench <file.obj>... [--iterations N]
+
+// The hash Model used before VertexWelder, kept here as the dedup baseline.
+namespace std {
+    template <> struct hash<XIV::Render::Model::Vertex> {
+        size_t operator()(XIV::Render::Model::Vertex const &vertex) const {
+            size_t seed = 0;
+            XIV::HashCombine(seed, vertex.Position, vertex.Color, vertex.Normal, vertex.Uv);
+            return seed;
+        }
+    };
+} // namespace std
+
+namespace {
+    double TimeMilliseconds(u32 iterations, const std::function<void()> &fn) {
+        double best = 0.0;
+        for (u32 i = 0; i < iterations; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            fn();
+            auto end = std::chrono::high_resolution_clock::now();
+            double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+            best = (i == 0 || elapsed < best) ? elapsed : best;
+        }
+        return best;
+    }
+
+    bool IsSameMesh(const Model::Builder &a, const Model::Builder &b) {
+        return a.Vertices.size() == b.Vertices.size() && a.Indices == b.Indices &&
+               memcmp(a.Vertices.data(),
+                      b.Vertices.data(),
+                      a.Vertices.size() * sizeof(Model::Vertex)) == 0;
+    }
+
+    // Dedup only, on corners that have already been parsed and expanded.
+    void BenchmarkWelding(const std::string &path, u32 iterations) {
+        ObjData data{};
+        ObjReader::Read(path, data);
+
+        std::vector<Model::Vertex> corners(data.Indices.size());
+        for (size_t i = 0; i < corners.size(); ++i) {
+            const ObjData::Index &index = data.Indices[i];
+            Model::Vertex &vertex = corners[i];
+            if (index.Position >= 0) {
+                const float *position = &data.Positions[3 * static_cast<size_t>(index.Position)];
+                const float *color = &data.Colors[3 * static_cast<size_t>(index.Position)];
+                vertex.Position = {position[0], position[1], position[2]};
+                vertex.Color = {color[0], color[1], color[2]};
+            }
+            if (index.Normal >= 0) {
+                const float *normal = &data.Normals[3 * static_cast<size_t>(index.Normal)];
+                vertex.Normal = {normal[0], normal[1], normal[2]};
+            }
+            if (index.Texcoord >= 0) {
+                const float *uv = &data.Texcoords[2 * static_cast<size_t>(index.Texcoord)];
+                vertex.Uv = {uv[0], uv[1]};
+            }
+        }
+
+        Model::Builder map{};
+        double mapTime = TimeMilliseconds(iterations, [&]() {
+            map.Vertices.clear();
+            map.Indices.clear();
+            std::unordered_map<Model::Vertex, u32> uniqueVertices{};
+            for (const auto &vertex : corners) {
+                if (uniqueVertices.count(vertex) == 0) {
+                    uniqueVertices[vertex] = static_cast<u32>(map.Vertices.size());
+                    map.Vertices.push_back(vertex);
+                }
+                map.Indices.push_back(uniqueVertices[vertex]);
+            }
+        });
+        std::cout << "  weld (map)       " << mapTime << " ms (" << map.Vertices.size()
+                  << " unique)" << std::endl;
+
+        Model::Builder serial{};
+        double serialTime = TimeMilliseconds(iterations, [&]() {
+            serial.Vertices.clear();
+            serial.Indices.clear();
+            serial.Indices.reserve(corners.size());
+            VertexWelder welder{serial.Vertices, corners.size() / 4};
+            for (const auto &vertex : corners) {
+                serial.Indices.push_back(welder.Weld(vertex));
+            }
+        });
+        std::cout << "  weld (flat)      " << serialTime << " ms (" << mapTime / serialTime
+                  << "x)" << (IsSameMesh(map, serial) ? "" : "  differs from map (-0.0 vs 0.0?)")
+                  << std::endl;
+
+        Model::Builder parallel{};
+        double parallelTime = TimeMilliseconds(iterations, [&]() {
+            VertexWelder::WeldParallel(
+                corners.data(), corners.size(), parallel.Vertices, parallel.Indices);
+        });
+        std::cout << "  weld (parallel)  " << parallelTime << " ms (" << mapTime / parallelTime
+                  << "x)" << (IsSameMesh(serial, parallel) ? "" : "  MISMATCH") << std::endl;
+    }
+
+    void BenchmarkFile(const std::string &path, u32 iterations) {
+        std::cout << path << std::endl;
+
+        Model::Builder reference{};
+        double tinyObjTime = TimeMilliseconds(iterations, [&]() {
+            reference.LoadObjFileTinyObj(path);
+        });
+        std::cout << "  tinyobj          " << tinyObjTime << " ms (" << reference.Vertices.size()
+                  << " vertices, " << reference.Indices.size() << " indices)" << std::endl;
+
+        Model::Builder parallel{};
+        double parallelTime = TimeMilliseconds(iterations, [&]() { parallel.LoadObjFile(path); });
+        std::cout << "  ObjReader        " << parallelTime << " ms ("
+                  << ThreadPool::Shared().ThreadCount() + 1 << " threads, "
+                  << tinyObjTime / parallelTime << "x)"
+                  << (IsSameMesh(reference, parallel) ? "" : "  MISMATCH") << std::endl;
+
+        BenchmarkWelding(path, iterations);
+
+        ModelLoadOptions options{};
+        options.OptimizeOverdraw = true;
+        auto start = std::chrono::high_resolution_clock::now();
+        MeshOptimizer::Result result = MeshOptimizer::Optimize(parallel, options);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "  optimize         "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms (ACMR "
+                  << result.Before.Acmr << " -> " << result.After.Acmr << ", ATVR "
+                  << result.Before.Atvr << " -> " << result.After.Atvr << ")" << std::endl;
+    }
+} // namespace
+
+int main(int argc, char **argv) {
+    u32 iterations = 3;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = static_cast<u32>(std::max(1, atoi(argv[++i])));
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <file.obj>... [--iterations N]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        for (const auto &path : paths) {
+            BenchmarkFile(path, iterations);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
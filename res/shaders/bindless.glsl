@@ -0,0 +1,21 @@
+// Declares BindlessTable's set. Include after enabling GL_EXT_nonuniform_qualifier, and wrap
+// indices that can differ within a draw in nonuniformEXT().
+#ifndef BINDLESS_GLSL
+#define BINDLESS_GLSL
+
+#define BINDLESS_SET 1
+
+layout(set = BINDLESS_SET, binding = 1) uniform texture2D bindlessTextures[];
+layout(set = BINDLESS_SET, binding = 2) uniform sampler bindlessSamplers[];
+
+// Storage buffers are declared per use, since each has its own layout:
+//   BINDLESS_BUFFER(MaterialBuffer) { Material materials[]; } materialBuffers[];
+#define BINDLESS_BUFFER(name) layout(std430, set = BINDLESS_SET, binding = 0) readonly buffer name
+
+vec4 sampleBindless(uint textureIndex, uint samplerIndex, vec2 uv) {
+  return texture(sampler2D(bindlessTextures[nonuniformEXT(textureIndex)],
+                           bindlessSamplers[nonuniformEXT(samplerIndex)]),
+                 uv);
+}
+
+#endif
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 :: run glslc to compile the shaders from GLSL to SPIR-V
 glslc simple.vert -o simple.vert.spv
+glslc simple_compact.vert -o simple_compact.vert.spv
 glslc simple.frag -o simple.frag.spv
 
 glslc light_point.vert -o light_point.vert.spv
@@ -9,51 +9,45 @@
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <cstring>
+#include <iostream>
 #include <stdexcept>
 
 using namespace XIV::Systems;
 
 namespace XIV {
     App::App() {
-        globalPool =
-            DescriptorPool::Builder(device)
-                .SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
-                .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
-                .Build();
+        if (device.IsBindlessSupported()) {
+            bindlessTable =
+                std::make_unique<BindlessTable>(device, SwapChain::MAX_FRAMES_IN_FLIGHT);
+        }
         LoadGameObjects();
     }
 
     App::~App() {}
 
     void App::Run() {
-        // Buffer shit
-        std::vector<std::unique_ptr<Buffer>> uboBuffers(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (size_t i = 0; i < uboBuffers.size(); ++i) {
-            uboBuffers[i] = std::make_unique<Buffer>(device,
-                                                     sizeof(GlobalUbo),
-                                                     1,
-                                                     VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-            uboBuffers[i]->Map();
-        }
-
-        auto globalSetLayout =
-            DescriptorSetLayout::Builder(device)
-                .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-                .Build();
-
-        std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (size_t i = 0; i < globalDescriptorSets.size(); ++i) {
-            auto bufferInfo = uboBuffers[i]->DescriptorInfo();
-            DescriptorWriter(*globalSetLayout, *globalPool)
-                .WriteBuffer(0, &bufferInfo)
-                .Build(globalDescriptorSets[i]);
-        }
-
+        // The ubo lives in the frame allocator; one set serves every frame through its offset.
+        auto globalSetLayout = DescriptorSetLayout::Builder(device)
+                                   .AddBinding(0,
+                                               VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                               VK_SHADER_STAGE_ALL_GRAPHICS)
+                                   .Build();
+
+        VkDescriptorSet globalDescriptorSet;
+        auto bufferInfo = frameAllocator.DescriptorInfo(sizeof(GlobalUbo));
+        DescriptorWriter(*globalSetLayout, globalDescriptors)
+            .WriteBuffer(0, &bufferInfo)
+            .Build(globalDescriptorSet);
+
+        // Both systems' pipelines compile at once, while the rest of startup carries on.
+        PipelineBuilder pipelineBuilder{device};
         SimpleRenderSystem simpleRenderSystem{device,
+                                              pipelineBuilder,
                                               renderer.GetSwapChainRenderPass(),
                                               globalSetLayout->VulkanDescriptorSetLayout};
         PointLightSystem pointLightSystem{device,
+                                          pipelineBuilder,
                                           renderer.GetSwapChainRenderPass(),
                                           globalSetLayout->VulkanDescriptorSetLayout};
         Camera camera{};
@@ -67,6 +61,7 @@ namespace XIV {
 
         while (!window.ShouldClose()) { // MAIN GAME LOOP
             glfwPollEvents();
+            modelStreamer.Update();
 
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime =
@@ -82,11 +77,23 @@ namespace XIV {
 
             if (auto commandBuffer = renderer.BeginFrame()) {
                 int frameIndex = renderer.GetFrameIndex();
+                frameAllocator.BeginFrame(frameIndex);
+                frameArena.BeginFrame(frameIndex);
+                frameDescriptors.BeginFrame(frameIndex);
+                if (bindlessTable != nullptr) {
+                    bindlessTable->BeginFrame(frameIndex);
+                }
+                auto uboAllocation = frameAllocator.AllocateUniform(sizeof(GlobalUbo));
                 FrameInfo frameInfo{frameIndex,
                                     frameTime,
                                     commandBuffer,
                                     camera,
-                                    globalDescriptorSets[frameIndex],
+                                    globalDescriptorSet,
+                                    uboAllocation.Offset,
+                                    frameAllocator,
+                                    frameArena,
+                                    frameDescriptors,
+                                    bindlessTable.get(),
                                     gameObjects};
 
                 // UPDATE ---------------------------------------
@@ -97,11 +104,12 @@ namespace XIV {
 
                 pointLightSystem.Update(frameInfo, ubo);
 
-                uboBuffers[frameIndex]->WriteToBuffer(&ubo);
-                uboBuffers[frameIndex]->Flush();
+                memcpy(uboAllocation.Mapped, &ubo, sizeof(GlobalUbo));
                 // ----------------------------------------------
 
                 // RENDER ---------------------------------------
+                // Copies must be recorded outside the render pass, before anything is drawn.
+                geometryPool.Defragment(commandBuffer);
                 renderer.BeginSwapChainRenderPass(commandBuffer);
 
                 // order here matters
@@ -109,34 +117,53 @@ namespace XIV {
                 pointLightSystem.Render(frameInfo);
 
                 renderer.EndSwapChainRenderPass(commandBuffer);
+                frameAllocator.Flush();
                 renderer.EndFrame();
                 // ----------------------------------------------
             }
         }
 
         vkDeviceWaitIdle(device.VulkanDevice);
+
+        device.GetPipelineCache().PrintStats(std::cout);
+        geometryPool.PrintDefragStats(std::cout);
+        if (HostAllocator::IS_ENABLED) {
+            device.GetHostAllocator().PrintReport(std::cout);
+        }
     }
 
     void App::LoadGameObjects() {
-        std::shared_ptr<Model> model = Model::CreateModelFromFile(device, "models/flat_vase.obj");
+        ModelLoadOptions modelOptions{};
+        modelOptions.Format = VertexFormat::Compact;
+        modelOptions.LodCount = 4;
+        modelOptions.BuildMeshlets = true;
+
+        // Objects start without a model and pop in once their upload has landed.
+        auto streamModel = [this, &modelOptions](GameObject::id_t id, const std::string &path) {
+            modelStreamer.LoadAsync(path, modelOptions, [this, id](const auto &model) {
+                auto it = gameObjects.find(id);
+                if (it != gameObjects.end()) {
+                    it->second.Model = model;
+                }
+            });
+        };
+
         auto flatVase = GameObject::CreateGameObject();
-        flatVase.Model = model;
         flatVase.Transform.Translation = {-.5f, .5f, 0.0f};
         flatVase.Transform.Scale = {3.f, 1.5f, 3.f};
+        streamModel(flatVase.Id, "models/flat_vase.obj");
         gameObjects.emplace(flatVase.Id, std::move(flatVase));
 
-        model = Model::CreateModelFromFile(device, "models/smooth_vase.obj");
         auto smoothVase = GameObject::CreateGameObject();
-        smoothVase.Model = model;
         smoothVase.Transform.Translation = {.5f, .5f, 0.0f};
         smoothVase.Transform.Scale = {3.f, 1.5f, 3.f};
+        streamModel(smoothVase.Id, "models/smooth_vase.obj");
         gameObjects.emplace(smoothVase.Id, std::move(smoothVase));
 
-        model = Model::CreateModelFromFile(device, "models/quad.obj");
         auto floor = GameObject::CreateGameObject();
-        floor.Model = model;
         floor.Transform.Translation = {0.f, .5f, 0.f};
         floor.Transform.Scale = {3.f, 1.f, 3.f};
+        streamModel(floor.Id, "models/quad.obj");
         gameObjects.emplace(floor.Id, std::move(floor));
 
         std::vector<Vec3> lightColors{
@@ -1,11 +1,17 @@
 #ifndef APP_H
 #define APP_H
 
+#include "render/bindlesstable.h"
 #include "render/descriptors.h"
 #include "render/device.h"
+#include "render/frameallocator.h"
+#include "render/geometrypool.h"
 #include "render/model.h"
+#include "render/modelregistry.h"
+#include "render/modelstreamer.h"
 #include "render/renderer.h"
 #include "render/window.h"
+#include "framearena.h"
 #include "gameobject.h"
 
 #include <memory>
@@ -30,9 +36,17 @@ namespace XIV {
         Window window{WIDTH, HEIGHT, "AYO VULKAN!!!"};
         Device device{window};
         Renderer renderer{window, device};
+        FrameAllocator frameAllocator{device, SwapChain::MAX_FRAMES_IN_FLIGHT};
+        FrameArena frameArena{SwapChain::MAX_FRAMES_IN_FLIGHT};
+        DescriptorAllocator globalDescriptors{device};
+        FrameDescriptorAllocator frameDescriptors{device, SwapChain::MAX_FRAMES_IN_FLIGHT};
+        // Only created when the device supports descriptor indexing.
+        std::unique_ptr<BindlessTable> bindlessTable;
+        GeometryPool geometryPool{device};
+        ModelRegistry modelRegistry{device, &geometryPool};
+        ModelStreamer modelStreamer{device, &modelRegistry, &geometryPool};
 
         // note: order of declarations matters
-        std::unique_ptr<DescriptorPool> globalPool{};
         GameObject::Map gameObjects;
     };
 } // namespace XIV
@@ -0,0 +1,78 @@
+#include "framearena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace XIV {
+    FrameArena::FrameArena(u32 frameCount, size_t frameSize) {
+        frames.reserve(frameCount);
+        for (u32 i = 0; i < frameCount; ++i) {
+            auto frame = std::make_unique<Frame>();
+            frame->Memory = std::make_unique<std::byte[]>(frameSize);
+            frame->Capacity = frameSize;
+            frames.push_back(std::move(frame));
+        }
+        current = frames.front().get();
+    }
+
+    FrameArena::~FrameArena() {
+        for (auto &frame : frames) {
+            ReleaseSpills(*frame);
+        }
+    }
+
+    void FrameArena::BeginFrame(u32 frameIndex) {
+        Frame &frame = *frames[frameIndex];
+        size_t used = frame.Head.load(std::memory_order_relaxed);
+        highWater = std::max(highWater, used + frame.SpilledBytes);
+
+        // Grow once to what the frame actually needed, rather than spilling every frame.
+        if (frame.SpilledBytes > 0) {
+            size_t capacity = std::max(frame.Capacity * 2, used + frame.SpilledBytes);
+            frame.Memory = std::make_unique<std::byte[]>(capacity);
+            frame.Capacity = capacity;
+        }
+        ReleaseSpills(frame);
+        frame.Head.store(0, std::memory_order_relaxed);
+        current = &frame;
+    }
+
+    size_t FrameArena::UsedBytes() const {
+        return current->Head.load(std::memory_order_relaxed) + current->SpilledBytes;
+    }
+
+    void *FrameArena::do_allocate(size_t bytes, size_t alignment) {
+        Frame &frame = *current;
+        auto base = reinterpret_cast<std::uintptr_t>(frame.Memory.get());
+
+        // Failed bumps never advance Head, so it stays within Capacity.
+        size_t head = frame.Head.load(std::memory_order_relaxed);
+        size_t begin = 0;
+        do {
+            // Align the address, not the offset, so alignments past max_align_t hold too.
+            begin = ((base + head + alignment - 1) & ~(alignment - 1)) - base;
+            if (begin + bytes > frame.Capacity) {
+                std::lock_guard<std::mutex> lock{spillMutex};
+                return SpillLocked(frame, bytes, alignment);
+            }
+        } while (!frame.Head.compare_exchange_weak(head, begin + bytes, std::memory_order_relaxed));
+
+        return frame.Memory.get() + begin;
+    }
+
+    void *FrameArena::SpillLocked(Frame &frame, size_t bytes, size_t alignment) {
+        void *pointer = std::pmr::get_default_resource()->allocate(bytes, alignment);
+        frame.Spills.push_back(Spill{pointer, bytes, alignment});
+        frame.SpilledBytes += bytes;
+        return pointer;
+    }
+
+    void FrameArena::ReleaseSpills(Frame &frame) {
+        for (const Spill &spill : frame.Spills) {
+            std::pmr::get_default_resource()->deallocate(
+                spill.Pointer, spill.Bytes, spill.Alignment);
+        }
+        frame.Spills.clear();
+        frame.SpilledBytes = 0;
+    }
+} // namespace XIV
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include "core.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace XIV {
+    // CPU scratch memory that lives for one frame. Each frame in flight has its own chunk, and
+    // allocation is an atomic pointer bump into it, so worker threads never touch the global
+    // heap or each other's locks. Nothing is freed individually; BeginFrame drops everything
+    // the slot held the last time around. Hand it to pmr containers:
+    //
+    //     std::pmr::vector<u32> visible{&frameArena};
+    //
+    // A frame that outgrows its chunk spills into the default resource, and the chunk grows to
+    // fit the next time that slot begins.
+    class FrameArena : public std::pmr::memory_resource {
+    public:
+        static constexpr size_t DEFAULT_FRAME_SIZE = 1024 * 1024;
+
+        FrameArena(u32 frameCount, size_t frameSize = DEFAULT_FRAME_SIZE);
+        ~FrameArena() override;
+        FrameArena(const FrameArena &) = delete;
+        FrameArena &operator=(const FrameArena &) = delete;
+
+        // Switches to frameIndex's chunk and empties it. Containers from the last frame that
+        // used the index must already be gone; the other slots are untouched, so data can be
+        // handed to the next frame.
+        void BeginFrame(u32 frameIndex);
+
+        size_t UsedBytes() const;
+        // Most a single frame has asked for, spills included.
+        size_t HighWaterBytes() const {
+            return highWater;
+        }
+
+    private:
+        struct Spill {
+            void *Pointer;
+            size_t Bytes;
+            size_t Alignment;
+        };
+
+        struct Frame {
+            std::unique_ptr<std::byte[]> Memory{};
+            size_t Capacity = 0;
+            std::atomic<size_t> Head{0};
+            std::vector<Spill> Spills{};
+            size_t SpilledBytes = 0;
+        };
+
+        void *do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void *, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+        void *SpillLocked(Frame &frame, size_t bytes, size_t alignment);
+        void ReleaseSpills(Frame &frame);
+
+        std::vector<std::unique_ptr<Frame>> frames;
+        Frame *current = nullptr;
+        size_t highWater = 0;
+        std::mutex spillMutex;
+    };
+} // namespace XIV
+
+#endif
\ No newline at end of file
@@ -49,6 +49,9 @@ namespace XIV {
         std::shared_ptr<Model> Model{};
         std::unique_ptr<PointLightComponent> PointLight = nullptr;
 
+        // Level of detail drawn last frame; SimpleRenderSystem uses it for hysteresis.
+        u32 LodLevel = 0;
+
     private:
         GameObject(id_t objId) : Id{objId} {}
     };
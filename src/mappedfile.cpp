@@ -0,0 +1,125 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace XIV {
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+#ifdef _WIN32
+    bool MappedFile::Open(const std::string &path) {
+        Close();
+
+        HANDLE file = CreateFileA(path.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                  nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            return false;
+        }
+
+        fileHandle = file;
+        size = static_cast<size_t>(fileSize.QuadPart);
+        isOpen = true;
+
+        // Zero-length files cannot be mapped, but are still valid (empty) files.
+        if (size == 0) {
+            return true;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            Close();
+            return false;
+        }
+        mappingHandle = mapping;
+
+        data = static_cast<const u8 *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (data == nullptr) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        if (fileHandle) {
+            CloseHandle(fileHandle);
+        }
+        data = nullptr;
+        size = 0;
+        isOpen = false;
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+    }
+#else
+    bool MappedFile::Open(const std::string &path) {
+        Close();
+
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+
+        size = static_cast<size_t>(info.st_size);
+        isOpen = true;
+
+        // Zero-length files cannot be mapped, but are still valid (empty) files.
+        if (size > 0) {
+            void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) {
+                close(fd);
+                size = 0;
+                isOpen = false;
+                return false;
+            }
+            madvise(view, size, MADV_SEQUENTIAL);
+            data = static_cast<const u8 *>(view);
+        }
+
+        // The mapping keeps its own reference to the file.
+        close(fd);
+        return true;
+    }
+
+    void MappedFile::Close() {
+        if (data) {
+            munmap(const_cast<u8 *>(data), size);
+        }
+        data = nullptr;
+        size = 0;
+        isOpen = false;
+    }
+#endif
+} // namespace XIV
\ No newline at end of file
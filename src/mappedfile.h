@@ -0,0 +1,45 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include "core.h"
+
+#include <cstddef>
+#include <string>
+
+namespace XIV {
+    // Read-only memory mapping of a whole file. The view stays valid until Close() or destruction.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        bool Open(const std::string &path);
+        void Close();
+
+        bool IsOpen() const {
+            return isOpen;
+        }
+
+        const u8 *Data() const {
+            return data;
+        }
+
+        size_t Size() const {
+            return size;
+        }
+
+    private:
+        const u8 *data = nullptr;
+        size_t size = 0;
+        bool isOpen = false;
+
+#ifdef _WIN32
+        void *fileHandle = nullptr;
+        void *mappingHandle = nullptr;
+#endif
+    };
+} // namespace XIV
+
+#endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "bindlesstable.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace XIV::Render {
+    BindlessTable::BindlessTable(Device &device,
+                                 u32 frameCount,
+                                 u32 storageBufferCount,
+                                 u32 sampledImageCount)
+        : device{device} {
+        assert(device.IsBindlessSupported() && "Device lacks descriptor indexing");
+
+        const BindlessLimits &limits = device.GetBindlessLimits();
+        storageBuffers.Capacity = std::min(storageBufferCount, limits.MaxStorageBuffers);
+        sampledImages.Capacity = std::min(sampledImageCount, limits.MaxSampledImages);
+        samplers.Capacity = MAX_SAMPLERS;
+        for (Slots *slots : {&storageBuffers, &sampledImages, &samplers}) {
+            slots->Retired.resize(frameCount);
+        }
+
+        const VkDescriptorBindingFlagsEXT bindingFlags =
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+        const VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        setLayout = DescriptorSetLayout::Builder(device)
+                        .AddBinding(STORAGE_BUFFER_BINDING,
+                                    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                    stages,
+                                    storageBuffers.Capacity,
+                                    bindingFlags)
+                        .AddBinding(SAMPLED_IMAGE_BINDING,
+                                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                                    stages,
+                                    sampledImages.Capacity,
+                                    bindingFlags)
+                        .AddBinding(SAMPLER_BINDING,
+                                    VK_DESCRIPTOR_TYPE_SAMPLER,
+                                    stages,
+                                    samplers.Capacity,
+                                    bindingFlags)
+                        .Build();
+
+        pool = DescriptorPool::Builder(device)
+                   .SetMaxSets(1)
+                   .SetPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT)
+                   .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBuffers.Capacity)
+                   .AddPoolSize(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, sampledImages.Capacity)
+                   .AddPoolSize(VK_DESCRIPTOR_TYPE_SAMPLER, samplers.Capacity)
+                   .Build();
+
+        if (!pool->AllocateDescriptor(setLayout->VulkanDescriptorSetLayout, descriptorSet)) {
+            throw std::runtime_error("failed to allocate bindless descriptor set!");
+        }
+    }
+
+    u32 BindlessTable::AddStorageBuffer(const VkDescriptorBufferInfo &bufferInfo) {
+        VkDescriptorBufferInfo info = bufferInfo;
+        std::lock_guard<std::mutex> lock{mutex};
+        u32 index = AcquireLocked(storageBuffers);
+        DescriptorWriter(*setLayout, *pool)
+            .WriteBuffer(STORAGE_BUFFER_BINDING, &info, index)
+            .Overwrite(descriptorSet);
+        return index;
+    }
+
+    u32 BindlessTable::AddSampledImage(const VkDescriptorImageInfo &imageInfo) {
+        VkDescriptorImageInfo info = imageInfo;
+        info.sampler = VK_NULL_HANDLE;
+        std::lock_guard<std::mutex> lock{mutex};
+        u32 index = AcquireLocked(sampledImages);
+        DescriptorWriter(*setLayout, *pool)
+            .WriteImage(SAMPLED_IMAGE_BINDING, &info, index)
+            .Overwrite(descriptorSet);
+        return index;
+    }
+
+    u32 BindlessTable::AddSampler(VkSampler sampler) {
+        VkDescriptorImageInfo info{};
+        info.sampler = sampler;
+        std::lock_guard<std::mutex> lock{mutex};
+        u32 index = AcquireLocked(samplers);
+        DescriptorWriter(*setLayout, *pool)
+            .WriteImage(SAMPLER_BINDING, &info, index)
+            .Overwrite(descriptorSet);
+        return index;
+    }
+
+    void BindlessTable::RemoveStorageBuffer(u32 index) {
+        Retire(storageBuffers, index);
+    }
+
+    void BindlessTable::RemoveSampledImage(u32 index) {
+        Retire(sampledImages, index);
+    }
+
+    void BindlessTable::RemoveSampler(u32 index) {
+        Retire(samplers, index);
+    }
+
+    void BindlessTable::BeginFrame(u32 frameIndex) {
+        std::lock_guard<std::mutex> lock{mutex};
+        currentFrame = frameIndex;
+        for (Slots *slots : {&storageBuffers, &sampledImages, &samplers}) {
+            std::vector<u32> &retired = slots->Retired[frameIndex];
+            slots->Free.insert(slots->Free.end(), retired.begin(), retired.end());
+            retired.clear();
+        }
+    }
+
+    void BindlessTable::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const {
+        vkCmdBindDescriptorSets(commandBuffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                pipelineLayout,
+                                SET_INDEX,
+                                1,
+                                &descriptorSet,
+                                0,
+                                nullptr);
+    }
+
+    u32 BindlessTable::AcquireLocked(Slots &slots) {
+        if (!slots.Free.empty()) {
+            u32 index = slots.Free.back();
+            slots.Free.pop_back();
+            return index;
+        }
+        if (slots.Next == slots.Capacity) {
+            throw std::runtime_error("bindless table is full!");
+        }
+        return slots.Next++;
+    }
+
+    void BindlessTable::Retire(Slots &slots, u32 index) {
+        // The stale descriptor stays in place; partially bound slots are fine as long as no
+        // shader reads them.
+        std::lock_guard<std::mutex> lock{mutex};
+        assert(index < slots.Next && "Index was never handed out");
+        slots.Retired[currentFrame].push_back(index);
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef BINDLESS_TABLE_H
+#define BINDLESS_TABLE_H
+
+#include "descriptors.h"
+#include "device.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace XIV::Render {
+    // One descriptor set holding large arrays of storage buffers, sampled images and samplers,
+    // bound once per frame. Draws pick their resources by index, e.g. from push constants,
+    // instead of binding a set each, so differently textured objects can share a draw.
+    //
+    // Needs Device::IsBindlessSupported. The arrays are partially bound, so only slots a shader
+    // actually reads must be valid, and update-after-bind, so resources can be added while
+    // frames in flight still have the set bound. Shaders declare it with bindless.glsl.
+    class BindlessTable {
+    public:
+        static constexpr u32 SET_INDEX = 1;
+        static constexpr u32 STORAGE_BUFFER_BINDING = 0;
+        static constexpr u32 SAMPLED_IMAGE_BINDING = 1;
+        static constexpr u32 SAMPLER_BINDING = 2;
+
+        static constexpr u32 DEFAULT_STORAGE_BUFFERS = 16 * 1024;
+        static constexpr u32 DEFAULT_SAMPLED_IMAGES = 16 * 1024;
+        static constexpr u32 MAX_SAMPLERS = 32;
+
+        // Capacities are clamped to the device's update-after-bind limits.
+        BindlessTable(Device &device,
+                      u32 frameCount,
+                      u32 storageBufferCount = DEFAULT_STORAGE_BUFFERS,
+                      u32 sampledImageCount = DEFAULT_SAMPLED_IMAGES);
+        BindlessTable(const BindlessTable &) = delete;
+        BindlessTable &operator=(const BindlessTable &) = delete;
+
+        // Each returns the index shaders use to reach the resource. Safe to call from any thread.
+        u32 AddStorageBuffer(const VkDescriptorBufferInfo &bufferInfo);
+        u32 AddSampledImage(const VkDescriptorImageInfo &imageInfo);
+        u32 AddSampler(VkSampler sampler);
+
+        // The index is only handed out again once frames in flight that may read it are done.
+        void RemoveStorageBuffer(u32 index);
+        void RemoveSampledImage(u32 index);
+        void RemoveSampler(u32 index);
+
+        // Recycles the indices removed the last time frameIndex was recorded. Only call once
+        // the GPU is done with that frame.
+        void BeginFrame(u32 frameIndex);
+
+        // pipelineLayout must have Layout() at SET_INDEX.
+        void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const;
+
+        DescriptorSetLayout &Layout() {
+            return *setLayout;
+        }
+
+    private:
+        // Free indices of one binding's array.
+        struct Slots {
+            u32 Capacity = 0;
+            u32 Next = 0; // never handed out at or past this
+            std::vector<u32> Free{};
+            std::vector<std::vector<u32>> Retired{}; // per frame in flight
+        };
+
+        u32 AcquireLocked(Slots &slots);
+        void Retire(Slots &slots, u32 index);
+
+        Device &device;
+        std::unique_ptr<DescriptorSetLayout> setLayout;
+        std::unique_ptr<DescriptorPool> pool;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+        std::mutex mutex;
+        Slots storageBuffers{};
+        Slots sampledImages{};
+        Slots samplers{};
+        u32 currentFrame = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
@@ -25,15 +25,38 @@ namespace XIV::Render {
         device.CreateBuffer(BufferSize, usageFlags, memoryPropertyFlags, VulkanBuffer, memory);
     }
 
+    Buffer::Buffer(Device &device,
+                   VkDeviceSize instanceSize,
+                   u32 instanceCount,
+                   VkBufferUsageFlags usageFlags,
+                   MemoryUsage memoryUsage,
+                   VkDeviceSize minOffsetAlignment)
+        : InstanceCount{instanceCount}, InstanceSize{instanceSize}, UsageFlags{usageFlags},
+          device{device} {
+        AlignmentSize = GetAlignment(instanceSize, minOffsetAlignment);
+        BufferSize = AlignmentSize * instanceCount;
+        device.CreateBuffer(BufferSize, usageFlags, memoryUsage, VulkanBuffer, memory);
+        MemoryPropertyFlags = device.GetAllocator().PropertyFlags(memory);
+    }
+
     Buffer::~Buffer() {
         Unmap();
-        vkDestroyBuffer(device.VulkanDevice, VulkanBuffer, nullptr);
-        vkFreeMemory(device.VulkanDevice, memory, nullptr);
+        // Frames in flight may still be reading the buffer.
+        VkDevice vulkanDevice = device.VulkanDevice;
+        VkBuffer buffer = VulkanBuffer;
+        MemoryAllocator &allocator = device.GetAllocator();
+        const VkAllocationCallbacks *callbacks = device.HostCallbacks();
+        device.GetDeletionQueue().Enqueue(
+            [vulkanDevice, buffer, callbacks, &allocator, allocation = memory]() mutable {
+                vkDestroyBuffer(vulkanDevice, buffer, callbacks);
+                allocator.Free(allocation);
+            });
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer
-     * range.
+     * range. Host-visible memory stays mapped by the allocator, so this only hands out a pointer;
+     * size is only checked against the buffer, in debug builds.
      *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the
      * complete buffer range.
@@ -41,21 +64,24 @@ namespace XIV::Render {
      *
      * @return VkResult of the buffer mapping call
      */
-    VkResult Buffer::Map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(VulkanBuffer && memory && "Called map on buffer before create");
-        return vkMapMemory(device.VulkanDevice, memory, offset, size, 0, &Mapped);
+    VkResult Buffer::Map([[maybe_unused]] VkDeviceSize size, VkDeviceSize offset) {
+        assert(VulkanBuffer && memory.Memory && "Called map on buffer before create");
+        assert((size == VK_WHOLE_SIZE ? offset <= BufferSize : offset + size <= BufferSize) &&
+               "Mapped range is past the end of the buffer");
+        if (memory.Mapped == nullptr) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        Mapped = static_cast<char *>(memory.Mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The allocation itself stays mapped until it is freed
      */
     void Buffer::Unmap() {
-        if (Mapped) {
-            vkUnmapMemory(device.VulkanDevice, memory);
-            Mapped = nullptr;
-        }
+        Mapped = nullptr;
     }
 
     /**
@@ -91,12 +117,7 @@ namespace XIV::Render {
      * @return VkResult of the flush call
      */
     VkResult Buffer::Flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(device.VulkanDevice, 1, &mappedRange);
+        return device.GetAllocator().Flush(memory, size, offset);
     }
 
     /**
@@ -127,12 +148,7 @@ namespace XIV::Render {
      * @return VkResult of the invalidate call
      */
     VkResult Buffer::Invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(device.VulkanDevice, 1, &mappedRange);
+        return device.GetAllocator().Invalidate(memory, size, offset);
     }
 
     /**
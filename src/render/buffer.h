@@ -12,6 +12,14 @@ namespace XIV::Render {
                VkBufferUsageFlags usageFlags,
                VkMemoryPropertyFlags memoryPropertyFlags,
                VkDeviceSize minOffsetAlignment = 1);
+        // Lets the device's MemoryPolicy pick the memory; MemoryPropertyFlags then holds the
+        // flags of the memory it picked.
+        Buffer(Device &device,
+               VkDeviceSize instanceSize,
+               u32 instanceCount,
+               VkBufferUsageFlags usageFlags,
+               MemoryUsage memoryUsage,
+               VkDeviceSize minOffsetAlignment = 1);
         ~Buffer();
         Buffer(const Buffer &) = delete;
         Buffer &operator=(const Buffer &) = delete;
@@ -30,6 +38,11 @@ namespace XIV::Render {
         VkDescriptorBufferInfo DescriptorInfoForIndex(int index);
         VkResult InvalidateIndex(int index);
 
+        // True when the CPU can write the buffer directly instead of staging a copy.
+        bool IsHostVisible() const {
+            return (MemoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+        }
+
         void *Mapped = nullptr;
         VkBuffer VulkanBuffer = VK_NULL_HANDLE;
         VkDeviceSize BufferSize;
@@ -44,7 +57,7 @@ namespace XIV::Render {
                                          VkDeviceSize minOffsetAlignment);
 
         Device &device;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        MemoryAllocation memory{};
     };
 
 } // namespace XIV::Render
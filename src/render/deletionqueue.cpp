@@ -0,0 +1,54 @@
+#include "deletionqueue.h"
+
+namespace XIV::Render {
+    DeletionQueue::DeletionQueue(u32 framesInFlight) : framesInFlight{framesInFlight} {}
+
+    DeletionQueue::~DeletionQueue() {
+        Flush();
+    }
+
+    void DeletionQueue::Enqueue(std::function<void()> destroy) {
+        std::lock_guard<std::mutex> lock{mutex};
+        pending.push_back({frame, std::move(destroy)});
+    }
+
+    void DeletionQueue::BeginFrame() {
+        std::deque<Entry> ready;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            ++frame;
+            // Entries are tagged in order, so the finished ones are all at the front.
+            while (!pending.empty() && pending.front().Frame + framesInFlight <= frame) {
+                ready.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+        }
+        Run(ready);
+    }
+
+    void DeletionQueue::Flush() {
+        while (true) {
+            std::deque<Entry> ready;
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                ready.swap(pending);
+            }
+            if (ready.empty()) {
+                return;
+            }
+            Run(ready);
+        }
+    }
+
+    size_t DeletionQueue::PendingCount() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return pending.size();
+    }
+
+    void DeletionQueue::Run(std::deque<Entry> &ready) {
+        // Outside the lock: destroying one thing may enqueue another.
+        for (Entry &entry : ready) {
+            entry.Destroy();
+        }
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,48 @@
+#ifndef DELETION_QUEUE_H
+#define DELETION_QUEUE_H
+
+#include "core.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace XIV::Render {
+    // Holds on to destruction work until the GPU can no longer be using the resource, so
+    // things can be dropped mid-session without idling the device. Work enqueued during
+    // frame n runs once frame n itself has finished, i.e. when frame n + framesInFlight
+    // begins.
+    class DeletionQueue {
+    public:
+        explicit DeletionQueue(u32 framesInFlight);
+        // Runs everything still pending; the device must be idle by then.
+        ~DeletionQueue();
+        DeletionQueue(const DeletionQueue &) = delete;
+        DeletionQueue &operator=(const DeletionQueue &) = delete;
+
+        // Safe to call from any thread.
+        void Enqueue(std::function<void()> destroy);
+        // Call at the start of each frame, after waiting on the fence of the frame slot it
+        // reuses. Runs the work of every frame that fence proves finished.
+        void BeginFrame();
+        // Runs everything pending. Only call with the device idle.
+        void Flush();
+
+        size_t PendingCount() const;
+
+    private:
+        struct Entry {
+            u64 Frame = 0;
+            std::function<void()> Destroy;
+        };
+
+        void Run(std::deque<Entry> &ready);
+
+        u32 framesInFlight;
+        mutable std::mutex mutex;
+        std::deque<Entry> pending;
+        u64 frame = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
@@ -1,13 +1,18 @@
 #include "descriptors.h"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
 namespace XIV::Render {
     // *************** Descriptor Set Layout Builder *********************
 
-    DescriptorSetLayout::Builder &DescriptorSetLayout::Builder::AddBinding(
-        u32 binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, u32 count) {
+    DescriptorSetLayout::Builder &
+    DescriptorSetLayout::Builder::AddBinding(u32 binding,
+                                             VkDescriptorType descriptorType,
+                                             VkShaderStageFlags stageFlags,
+                                             u32 count,
+                                             VkDescriptorBindingFlagsEXT flags) {
         assert(bindings.count(binding) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding layoutBinding{};
         layoutBinding.binding = binding;
@@ -15,38 +20,41 @@ namespace XIV::Render {
         layoutBinding.descriptorCount = count;
         layoutBinding.stageFlags = stageFlags;
         bindings[binding] = layoutBinding;
+        if (flags != 0) {
+            bindingFlags[binding] = flags;
+        }
         return *this;
     }
 
     std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::Build() const {
-        return std::make_unique<DescriptorSetLayout>(device, bindings);
+        return std::make_unique<DescriptorSetLayout>(device, bindings, bindingFlags);
     }
 
     // *************** Descriptor Set Layout *********************
 
     DescriptorSetLayout::DescriptorSetLayout(
-        Device &device, std::unordered_map<u32, VkDescriptorSetLayoutBinding> bindings)
+        Device &device,
+        std::unordered_map<u32, VkDescriptorSetLayoutBinding> bindings,
+        std::unordered_map<u32, VkDescriptorBindingFlagsEXT> bindingFlags)
         : device{device}, bindings{bindings} {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        std::vector<VkDescriptorBindingFlagsEXT> setLayoutBindingFlags{};
         for (auto kv : bindings) {
             setLayoutBindings.push_back(kv.second);
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+            isUpdateAfterBind = isUpdateAfterBind ||
+                                (setLayoutBindingFlags.back() &
+                                 VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT) != 0;
         }
-
-        VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
-        descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        descriptorSetLayoutInfo.bindingCount = static_cast<u32>(setLayoutBindings.size());
-        descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
-
-        if (vkCreateDescriptorSetLayout(device.VulkanDevice,
-                                        &descriptorSetLayoutInfo,
-                                        nullptr,
-                                        &VulkanDescriptorSetLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create descriptor set layout!");
+        if (bindingFlags.empty()) {
+            setLayoutBindingFlags.clear();
         }
-    }
 
-    DescriptorSetLayout::~DescriptorSetLayout() {
-        vkDestroyDescriptorSetLayout(device.VulkanDevice, VulkanDescriptorSetLayout, nullptr);
+        VkDescriptorSetLayoutCreateFlags flags =
+            isUpdateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT : 0;
+        VulkanDescriptorSetLayout = device.GetLayoutCache().GetSetLayout(
+            setLayoutBindings, setLayoutBindingFlags, flags);
     }
 
     // *************** Descriptor Pool Builder *********************
@@ -85,16 +93,22 @@ namespace XIV::Render {
         descriptorPoolInfo.maxSets = maxSets;
         descriptorPoolInfo.flags = poolFlags;
 
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_DESCRIPTOR_POOL};
         if (vkCreateDescriptorPool(device.VulkanDevice,
                                    &descriptorPoolInfo,
-                                   nullptr,
+                                   device.HostCallbacks(),
                                    &descriptorPool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor pool!");
         }
     }
 
     DescriptorPool::~DescriptorPool() {
-        vkDestroyDescriptorPool(device.VulkanDevice, descriptorPool, nullptr);
+        VkDevice vulkanDevice = device.VulkanDevice;
+        VkDescriptorPool pool = descriptorPool;
+        const VkAllocationCallbacks *callbacks = device.HostCallbacks();
+        device.GetDeletionQueue().Enqueue([vulkanDevice, pool, callbacks]() {
+            vkDestroyDescriptorPool(vulkanDevice, pool, callbacks);
+        });
     }
 
     bool DescriptorPool::AllocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout,
@@ -105,8 +119,7 @@ namespace XIV::Render {
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
+        // Fixed size; DescriptorAllocator adds pools as they fill up instead.
         if (vkAllocateDescriptorSets(device.VulkanDevice, &allocInfo, &descriptor) != VK_SUCCESS) {
             return false;
         }
@@ -114,35 +127,148 @@ namespace XIV::Render {
     }
 
     void DescriptorPool::FreeDescriptors(std::vector<VkDescriptorSet> &descriptors) const {
-        vkFreeDescriptorSets(device.VulkanDevice,
-                             descriptorPool,
-                             static_cast<u32>(descriptors.size()),
-                             descriptors.data());
+        // The sets may still be bound by frames in flight.
+        VkDevice vulkanDevice = device.VulkanDevice;
+        VkDescriptorPool pool = descriptorPool;
+        device.GetDeletionQueue().Enqueue([vulkanDevice, pool, sets = descriptors]() {
+            vkFreeDescriptorSets(vulkanDevice, pool, static_cast<u32>(sets.size()), sets.data());
+        });
     }
 
     void DescriptorPool::ResetPool() {
         vkResetDescriptorPool(device.VulkanDevice, descriptorPool, 0);
     }
 
+    // *************** Descriptor Allocator *********************
+
+    std::vector<DescriptorAllocator::PoolSizeRatio> DescriptorAllocator::DefaultRatios() {
+        return {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+                {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f},
+                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 0.5f},
+                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+                {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+                {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f}};
+    }
+
+    DescriptorAllocator::DescriptorAllocator(Device &device,
+                                             std::vector<PoolSizeRatio> ratios,
+                                             u32 setsPerPool)
+        : device{device}, ratios{std::move(ratios)}, setsPerPool{setsPerPool} {}
+
+    DescriptorAllocator::~DescriptorAllocator() {
+        VkDevice vulkanDevice = device.VulkanDevice;
+        const VkAllocationCallbacks *callbacks = device.HostCallbacks();
+        for (auto *pools : {&readyPools, &fullPools}) {
+            for (VkDescriptorPool pool : *pools) {
+                device.GetDeletionQueue().Enqueue([vulkanDevice, pool, callbacks]() {
+                    vkDestroyDescriptorPool(vulkanDevice, pool, callbacks);
+                });
+            }
+        }
+    }
+
+    bool DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set) {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = GrabPool();
+        allocInfo.pSetLayouts = &layout;
+        allocInfo.descriptorSetCount = 1;
+
+        VkResult result = vkAllocateDescriptorSets(device.VulkanDevice, &allocInfo, &set);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            // Retire the pool until the next Reset and retry once with a fresh one.
+            fullPools.push_back(readyPools.back());
+            readyPools.pop_back();
+            allocInfo.descriptorPool = GrabPool();
+            result = vkAllocateDescriptorSets(device.VulkanDevice, &allocInfo, &set);
+        }
+        return result == VK_SUCCESS;
+    }
+
+    void DescriptorAllocator::Reset() {
+        for (auto *pools : {&readyPools, &fullPools}) {
+            for (VkDescriptorPool pool : *pools) {
+                vkResetDescriptorPool(device.VulkanDevice, pool, 0);
+            }
+        }
+        readyPools.insert(readyPools.end(), fullPools.begin(), fullPools.end());
+        fullPools.clear();
+    }
+
+    VkDescriptorPool DescriptorAllocator::GrabPool() {
+        if (readyPools.empty()) {
+            readyPools.push_back(CreatePool(setsPerPool));
+            setsPerPool = std::min(setsPerPool + setsPerPool / 2, MAX_SETS_PER_POOL);
+        }
+        return readyPools.back();
+    }
+
+    VkDescriptorPool DescriptorAllocator::CreatePool(u32 setCount) {
+        std::vector<VkDescriptorPoolSize> poolSizes{};
+        for (const PoolSizeRatio &ratio : ratios) {
+            u32 count = std::max(1u, static_cast<u32>(ratio.Ratio * setCount));
+            poolSizes.push_back({ratio.Type, count});
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<u32>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = setCount;
+
+        VkDescriptorPool pool;
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_DESCRIPTOR_POOL};
+        if (vkCreateDescriptorPool(device.VulkanDevice, &poolInfo, device.HostCallbacks(), &pool) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        return pool;
+    }
+
+    FrameDescriptorAllocator::FrameDescriptorAllocator(
+        Device &device,
+        u32 frameCount,
+        const std::vector<DescriptorAllocator::PoolSizeRatio> &ratios) {
+        for (u32 i = 0; i < frameCount; ++i) {
+            frames.push_back(std::make_unique<DescriptorAllocator>(device, ratios));
+        }
+    }
+
+    void FrameDescriptorAllocator::BeginFrame(u32 frameIndex) {
+        current = frameIndex;
+        frames[current]->Reset();
+    }
+
     // *************** Descriptor Writer *********************
 
-    DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool)
-        : setLayout{setLayout}, pool{pool} {}
+    DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout,
+                                       DescriptorPool &pool,
+                                       std::pmr::memory_resource *scratch)
+        : setLayout{setLayout}, device{pool.device}, pool{&pool}, writes{scratch} {}
+
+    DescriptorWriter::DescriptorWriter(DescriptorSetLayout &setLayout,
+                                       DescriptorAllocator &allocator,
+                                       std::pmr::memory_resource *scratch)
+        : setLayout{setLayout}, device{setLayout.device}, allocator{&allocator},
+          writes{scratch} {}
 
     DescriptorWriter &DescriptorWriter::WriteBuffer(u32 binding,
-                                                    VkDescriptorBufferInfo *bufferInfo) {
+                                                    VkDescriptorBufferInfo *bufferInfo,
+                                                    u32 arrayElement) {
         assert(setLayout.bindings.count(binding) == 1 &&
                "Layout does not contain specified binding");
 
         auto &bindingDescription = setLayout.bindings[binding];
 
-        assert(bindingDescription.descriptorCount == 1 &&
-               "Binding single descriptor info, but binding expects multiple");
+        assert(arrayElement < bindingDescription.descriptorCount &&
+               "Array element is past the end of the binding");
 
         VkWriteDescriptorSet write{};
         write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         write.descriptorType = bindingDescription.descriptorType;
         write.dstBinding = binding;
+        write.dstArrayElement = arrayElement;
         write.pBufferInfo = bufferInfo;
         write.descriptorCount = 1;
 
@@ -150,19 +276,21 @@ namespace XIV::Render {
         return *this;
     }
 
-    DescriptorWriter &DescriptorWriter::WriteImage(u32 binding, VkDescriptorImageInfo *imageInfo) {
+    DescriptorWriter &
+    DescriptorWriter::WriteImage(u32 binding, VkDescriptorImageInfo *imageInfo, u32 arrayElement) {
         assert(setLayout.bindings.count(binding) == 1 &&
                "Layout does not contain specified binding");
 
         auto &bindingDescription = setLayout.bindings[binding];
 
-        assert(bindingDescription.descriptorCount == 1 &&
-               "Binding single descriptor info, but binding expects multiple");
+        assert(arrayElement < bindingDescription.descriptorCount &&
+               "Array element is past the end of the binding");
 
         VkWriteDescriptorSet write{};
         write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         write.descriptorType = bindingDescription.descriptorType;
         write.dstBinding = binding;
+        write.dstArrayElement = arrayElement;
         write.pImageInfo = imageInfo;
         write.descriptorCount = 1;
 
@@ -171,7 +299,9 @@ namespace XIV::Render {
     }
 
     bool DescriptorWriter::Build(VkDescriptorSet &set) {
-        bool success = pool.AllocateDescriptor(setLayout.VulkanDescriptorSetLayout, set);
+        bool success = pool != nullptr
+                           ? pool->AllocateDescriptor(setLayout.VulkanDescriptorSetLayout, set)
+                           : allocator->Allocate(setLayout.VulkanDescriptorSetLayout, set);
         if (!success) {
             return false;
         }
@@ -183,6 +313,6 @@ namespace XIV::Render {
         for (auto &write : writes) {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(pool.device.VulkanDevice, writes.size(), writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(device.VulkanDevice, writes.size(), writes.data(), 0, nullptr);
     }
 } // namespace XIV
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "device.h"
 
 #include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <vector>
 
@@ -14,28 +15,41 @@ namespace XIV::Render {
         public:
             Builder(Device &device) : device{device} {}
 
+            // bindingFlags need VK_EXT_descriptor_indexing; see Device::IsBindlessSupported.
+            // Any update-after-bind binding makes the whole layout update-after-bind.
             Builder &AddBinding(u32 binding,
                                 VkDescriptorType descriptorType,
                                 VkShaderStageFlags stageFlags,
-                                u32 count = 1);
+                                u32 count = 1,
+                                VkDescriptorBindingFlagsEXT bindingFlags = 0);
             std::unique_ptr<DescriptorSetLayout> Build() const;
 
         private:
             Device &device;
             std::unordered_map<u32, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<u32, VkDescriptorBindingFlagsEXT> bindingFlags{};
         };
 
+        // The handle comes from the device's LayoutCache, so identical bindings share one
+        // VkDescriptorSetLayout and the cache destroys it.
         DescriptorSetLayout(Device &device,
-                            std::unordered_map<u32, VkDescriptorSetLayoutBinding> bindings);
-        ~DescriptorSetLayout();
+                            std::unordered_map<u32, VkDescriptorSetLayoutBinding> bindings,
+                            std::unordered_map<u32, VkDescriptorBindingFlagsEXT> bindingFlags = {});
         DescriptorSetLayout(const DescriptorSetLayout &) = delete;
         DescriptorSetLayout &operator=(const DescriptorSetLayout &) = delete;
 
+        // Sets of this layout must come from a pool created with
+        // VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT.
+        bool IsUpdateAfterBind() const {
+            return isUpdateAfterBind;
+        }
+
         VkDescriptorSetLayout VulkanDescriptorSetLayout;
 
     private:
         Device &device;
         std::unordered_map<u32, VkDescriptorSetLayoutBinding> bindings;
+        bool isUpdateAfterBind = false;
 
         friend class DescriptorWriter;
     };
@@ -80,20 +94,103 @@ namespace XIV::Render {
         friend class DescriptorWriter;
     };
 
-    class DescriptorWriter {
+    // Hands out sets from a list of pools, adding a pool whenever the current one runs out of
+    // sets or fragments, so callers never size pools by hand. Each new pool is larger than the
+    // last, up to MAX_SETS_PER_POOL. Sets are not freed one by one; Reset returns all of them.
+    class DescriptorAllocator {
+    public:
+        static constexpr u32 DEFAULT_SETS_PER_POOL = 64;
+        static constexpr u32 MAX_SETS_PER_POOL = 4096;
+
+        // Descriptors of a type to reserve per set, e.g. 2 uniform buffers for every set.
+        struct PoolSizeRatio {
+            VkDescriptorType Type;
+            float Ratio;
+        };
+
+        static std::vector<PoolSizeRatio> DefaultRatios();
+
+        DescriptorAllocator(Device &device,
+                            std::vector<PoolSizeRatio> ratios = DefaultRatios(),
+                            u32 setsPerPool = DEFAULT_SETS_PER_POOL);
+        // Pools are destroyed once frames in flight are done with their sets.
+        ~DescriptorAllocator();
+        DescriptorAllocator(const DescriptorAllocator &) = delete;
+        DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+        // Returns false only for errors a new pool cannot fix, such as host memory running out.
+        bool Allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set);
+        // Hands every set back at once with vkResetDescriptorPool. The GPU must be done with
+        // them.
+        void Reset();
+
+        size_t PoolCount() const {
+            return readyPools.size() + fullPools.size();
+        }
+
+    private:
+        VkDescriptorPool GrabPool();
+        VkDescriptorPool CreatePool(u32 setCount);
+
+        Device &device;
+        std::vector<PoolSizeRatio> ratios;
+        u32 setsPerPool;
+        std::vector<VkDescriptorPool> readyPools{}; // the last one is allocated from
+        std::vector<VkDescriptorPool> fullPools{};
+    };
+
+    // A DescriptorAllocator per frame in flight, for sets that are written every frame. They are
+    // reset in bulk when their frame comes around again rather than freed.
+    class FrameDescriptorAllocator {
     public:
-        DescriptorWriter(DescriptorSetLayout &setLayout, DescriptorPool &pool);
+        FrameDescriptorAllocator(Device &device,
+                                 u32 frameCount,
+                                 const std::vector<DescriptorAllocator::PoolSizeRatio> &ratios =
+                                     DescriptorAllocator::DefaultRatios());
+
+        // Resets frameIndex's pools. Only call once the GPU is done with the last frame that
+        // used the index.
+        void BeginFrame(u32 frameIndex);
+
+        bool Allocate(VkDescriptorSetLayout layout, VkDescriptorSet &set) {
+            return frames[current]->Allocate(layout, set);
+        }
+
+        DescriptorAllocator &Current() {
+            return *frames[current];
+        }
 
-        DescriptorWriter &WriteBuffer(u32 binding, VkDescriptorBufferInfo *bufferInfo);
-        DescriptorWriter &WriteImage(u32 binding, VkDescriptorImageInfo *imageInfo);
+    private:
+        std::vector<std::unique_ptr<DescriptorAllocator>> frames;
+        u32 current = 0;
+    };
+
+    class DescriptorWriter {
+    public:
+        // scratch backs the pending writes; pass a FrameArena when writing sets every frame.
+        DescriptorWriter(DescriptorSetLayout &setLayout,
+                         DescriptorPool &pool,
+                         std::pmr::memory_resource *scratch = std::pmr::get_default_resource());
+        // Build allocates from allocator instead of a fixed pool.
+        DescriptorWriter(DescriptorSetLayout &setLayout,
+                         DescriptorAllocator &allocator,
+                         std::pmr::memory_resource *scratch = std::pmr::get_default_resource());
+
+        // arrayElement picks one descriptor of an array binding.
+        DescriptorWriter &
+        WriteBuffer(u32 binding, VkDescriptorBufferInfo *bufferInfo, u32 arrayElement = 0);
+        DescriptorWriter &
+        WriteImage(u32 binding, VkDescriptorImageInfo *imageInfo, u32 arrayElement = 0);
 
         bool Build(VkDescriptorSet &set);
         void Overwrite(VkDescriptorSet &set);
 
     private:
         DescriptorSetLayout &setLayout;
-        DescriptorPool &pool;
-        std::vector<VkWriteDescriptorSet> writes;
+        Device &device;
+        DescriptorPool *pool = nullptr;
+        DescriptorAllocator *allocator = nullptr;
+        std::pmr::vector<VkWriteDescriptorSet> writes;
     };
 
 } // namespace XIV::Render
@@ -1,7 +1,11 @@
 #include "device.h"
+#include "swapchain.h"
+#include "uploadcontext.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <set>
 #include <unordered_set>
 
@@ -41,6 +45,19 @@ namespace XIV::Render {
             func(instance, debugMessenger, pAllocator);
         }
     }
+
+    MemoryCategory CategoryForBufferUsage(VkBufferUsageFlags usage) {
+        if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+            return MemoryCategory::Geometry;
+        }
+        if (usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+            return MemoryCategory::Uniforms;
+        }
+        if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) {
+            return MemoryCategory::Staging;
+        }
+        return MemoryCategory::Other;
+    }
 #pragma endregion
 
 #pragma region Device Class Member Functions
@@ -51,18 +68,32 @@ namespace XIV::Render {
         PickPhysicalDevice();
         CreateLogicalDevice();
         CreateCommandPool();
+        allocator =
+            std::make_unique<MemoryAllocator>(physicalDevice, VulkanDevice, HostCallbacks());
+        deletionQueue = std::make_unique<DeletionQueue>(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        layoutCache = std::make_unique<LayoutCache>(*this);
+        pipelineCache = std::make_unique<PipelineCache>(*this);
+        uploadContext = std::make_unique<UploadContext>(*this);
     }
 
     Device::~Device() {
-        vkDestroyCommandPool(VulkanDevice, CommandPool, nullptr);
-        vkDestroyDevice(VulkanDevice, nullptr);
+        vkDeviceWaitIdle(VulkanDevice);
+        uploadContext.reset();
+        // Runs the remaining deferred destruction, which still frees through the allocator.
+        deletionQueue.reset();
+        layoutCache.reset();
+        // Writes the cache back to disk.
+        pipelineCache.reset();
+        allocator.reset();
+        vkDestroyCommandPool(VulkanDevice, CommandPool, HostCallbacks());
+        vkDestroyDevice(VulkanDevice, HostCallbacks());
 
         if (VALIDATION_LAYERS_ENABLED) {
-            DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+            DestroyDebugUtilsMessengerEXT(instance, debugMessenger, HostCallbacks());
         }
 
         vkDestroySurfaceKHR(instance, Surface, nullptr);
-        vkDestroyInstance(instance, nullptr);
+        vkDestroyInstance(instance, HostCallbacks());
     }
 
     u32 Device::FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties) {
@@ -99,30 +130,77 @@ namespace XIV::Render {
                               VkBufferUsageFlags usage,
                               VkMemoryPropertyFlags properties,
                               VkBuffer &buffer,
-                              VkDeviceMemory &bufferMemory) {
+                              MemoryAllocation &bufferMemory) {
+        VkMemoryRequirements memoryReqs;
+        buffer = CreateBufferHandle(size, usage, memoryReqs);
+
+        try {
+            bufferMemory =
+                allocator->Allocate(memoryReqs, properties, true, CategoryForBufferUsage(usage));
+        } catch (...) {
+            vkDestroyBuffer(VulkanDevice, buffer, HostCallbacks());
+            buffer = VK_NULL_HANDLE;
+            throw;
+        }
+
+        vkBindBufferMemory(VulkanDevice, buffer, bufferMemory.Memory, bufferMemory.Offset);
+    }
+
+    void Device::CreateBuffer(VkDeviceSize size,
+                              VkBufferUsageFlags usage,
+                              MemoryUsage memoryUsage,
+                              VkBuffer &buffer,
+                              MemoryAllocation &bufferMemory) {
+        VkMemoryRequirements memoryReqs;
+        buffer = CreateBufferHandle(size, usage, memoryReqs);
+
+        try {
+            bufferMemory =
+                allocator->Allocate(memoryReqs, memoryUsage, true, CategoryForBufferUsage(usage));
+        } catch (...) {
+            vkDestroyBuffer(VulkanDevice, buffer, HostCallbacks());
+            buffer = VK_NULL_HANDLE;
+            throw;
+        }
+
+        vkBindBufferMemory(VulkanDevice, buffer, bufferMemory.Memory, bufferMemory.Offset);
+    }
+
+    VkBuffer Device::CreateBufferHandle(VkDeviceSize size,
+                                        VkBufferUsageFlags usage,
+                                        VkMemoryRequirements &memoryReqs) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(VulkanDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        VkBuffer buffer;
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_BUFFER};
+        if (vkCreateBuffer(VulkanDevice, &bufferInfo, HostCallbacks(), &buffer) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create the vertex buffer.");
         }
 
-        VkMemoryRequirements memoryReqs;
         vkGetBufferMemoryRequirements(VulkanDevice, buffer, &memoryReqs);
+        return buffer;
+    }
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memoryReqs.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memoryReqs.memoryTypeBits, properties);
+    UploadContext &Device::GetUploadContext() {
+        return *uploadContext;
+    }
 
-        if (vkAllocateMemory(VulkanDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate vertex buffer memory.");
+    MemoryBudget Device::GetMemoryBudget() {
+        if (getMemoryProperties2 == nullptr) {
+            return allocator->GetBudget();
         }
 
-        vkBindBufferMemory(VulkanDevice, buffer, bufferMemory, 0);
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+        memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        memoryProperties.pNext = &budgetProperties;
+        getMemoryProperties2(physicalDevice, &memoryProperties);
+        return allocator->GetBudget(budgetProperties.heapBudget, budgetProperties.heapUsage);
     }
 
     VkCommandBuffer Device::BeginSingleTimeCommands() {
@@ -151,8 +229,18 @@ namespace XIV::Render {
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(GraphicsQueue);
+        // Wait on this submission alone rather than idling the whole queue.
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence;
+        vkCreateFence(VulkanDevice, &fenceInfo, HostCallbacks(), &fence);
+
+        {
+            std::lock_guard<std::mutex> queueLock{queueMutex};
+            vkQueueSubmit(GraphicsQueue, 1, &submitInfo, fence);
+        }
+        vkWaitForFences(VulkanDevice, 1, &fence, VK_TRUE, std::numeric_limits<u64>::max());
+        vkDestroyFence(VulkanDevice, fence, HostCallbacks());
 
         vkFreeCommandBuffers(VulkanDevice, CommandPool, 1, &commandBuffer);
     }
@@ -198,24 +286,23 @@ namespace XIV::Render {
     void Device::CreateImageWithInfo(const VkImageCreateInfo &imageInfo,
                                      VkMemoryPropertyFlags properties,
                                      VkImage &image,
-                                     VkDeviceMemory &imageMemory) {
-        if (vkCreateImage(VulkanDevice, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+                                     MemoryAllocation &imageMemory) {
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_IMAGE};
+        if (vkCreateImage(VulkanDevice, &imageInfo, HostCallbacks(), &image) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create image.");
         }
 
         VkMemoryRequirements memoryReqs;
         vkGetImageMemoryRequirements(VulkanDevice, image, &memoryReqs);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memoryReqs.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memoryReqs.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(VulkanDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate image memory.");
-        }
+        bool isLinear = imageInfo.tiling == VK_IMAGE_TILING_LINEAR;
+        MemoryCategory category = (imageInfo.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                                      ? MemoryCategory::Depth
+                                      : MemoryCategory::Textures;
+        imageMemory = allocator->Allocate(memoryReqs, properties, isLinear, category);
 
-        if (vkBindImageMemory(VulkanDevice, image, imageMemory, 0) != VK_SUCCESS) {
+        if (vkBindImageMemory(VulkanDevice, image, imageMemory.Memory, imageMemory.Offset) !=
+            VK_SUCCESS) {
             throw std::runtime_error("Failed to bind image memory.");
         }
     }
@@ -241,6 +328,12 @@ namespace XIV::Render {
 
         // Extensions
         std::vector<const char *> extensions = GetRequiredExtensions();
+        // Optional; needed to query VK_EXT_memory_budget on a 1.0 instance.
+        isProperties2Enabled =
+            IsInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        if (isProperties2Enabled) {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        }
         createInfo.enabledExtensionCount = static_cast<u32>(extensions.size());
         createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -257,7 +350,8 @@ namespace XIV::Render {
         }
 
         // Create the instance
-        if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_INSTANCE};
+        if (vkCreateInstance(&createInfo, HostCallbacks(), &instance) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create instance.");
         }
 
@@ -272,7 +366,7 @@ namespace XIV::Render {
 
         VkDebugUtilsMessengerCreateInfoEXT createInfo;
         PopulateDebugMessengerCreateInfo(createInfo);
-        if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) !=
+        if (CreateDebugUtilsMessengerEXT(instance, &createInfo, HostCallbacks(), &debugMessenger) !=
             VK_SUCCESS) {
             throw std::runtime_error("Failed to set up debug messenger.");
         }
@@ -315,7 +409,8 @@ namespace XIV::Render {
         QueueFamilyIndices indices = FindQueueFamilies(physicalDevice);
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<u32> uniqueQueueFamilies = {indices.GraphicsFamily, indices.PresentFamily};
+        std::set<u32> uniqueQueueFamilies = {
+            indices.GraphicsFamily, indices.PresentFamily, indices.TransferFamily};
 
         float queuePriority = 1.0f;
         for (u32 queueFamily : uniqueQueueFamilies) {
@@ -336,9 +431,34 @@ namespace XIV::Render {
         createInfo.queueCreateInfoCount = static_cast<u32>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+        std::vector<const char *> extensions = DEVICE_EXTENSIONS;
+        bool isMemoryBudgetAvailable =
+            isProperties2Enabled &&
+            IsDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        if (isMemoryBudgetAvailable) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+
+        // Optional; only used to report pipeline cache hits.
+        isPipelineFeedbackSupported = IsDeviceExtensionAvailable(
+            physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        if (isPipelineFeedbackSupported) {
+            extensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        }
+
+        // Optional; the bindless path is only used when the device has all of it.
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        isBindlessSupported = QueryBindlessSupport(indexingFeatures);
+        if (isBindlessSupported) {
+            extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+            extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            createInfo.pNext = &indexingFeatures;
+        }
+
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<u32>(DEVICE_EXTENSIONS.size());
-        createInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+        createInfo.enabledExtensionCount = static_cast<u32>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
 
         // TODO (mara): device-specific validation layer support is deprecated.
         if (VALIDATION_LAYERS_ENABLED) {
@@ -348,12 +468,20 @@ namespace XIV::Render {
             createInfo.enabledLayerCount = 0;
         }
 
-        if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &VulkanDevice) != VK_SUCCESS) {
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_DEVICE};
+        if (vkCreateDevice(physicalDevice, &createInfo, HostCallbacks(), &VulkanDevice) !=
+            VK_SUCCESS) {
             throw std::runtime_error("failed to create logical device!");
         }
 
         vkGetDeviceQueue(VulkanDevice, indices.GraphicsFamily, 0, &GraphicsQueue);
         vkGetDeviceQueue(VulkanDevice, indices.PresentFamily, 0, &PresentQueue);
+        vkGetDeviceQueue(VulkanDevice, indices.TransferFamily, 0, &TransferQueue);
+
+        if (isMemoryBudgetAvailable) {
+            getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)
+                vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+        }
     }
 
     void Device::CreateCommandPool() {
@@ -364,7 +492,8 @@ namespace XIV::Render {
         poolInfo.flags =
             VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-        if (vkCreateCommandPool(VulkanDevice, &poolInfo, nullptr, &CommandPool) != VK_SUCCESS) {
+        if (vkCreateCommandPool(VulkanDevice, &poolInfo, HostCallbacks(), &CommandPool) !=
+            VK_SUCCESS) {
             throw std::runtime_error("Failed to create command pool.");
         }
     }
@@ -452,6 +581,29 @@ namespace XIV::Render {
             i++;
         }
 
+        // Prefer a transfer-only family (usually a dedicated copy engine), then any other
+        // family that can copy without graphics. Copies there overlap rendering.
+        int bestScore = 0;
+        for (u32 family = 0; family < queueFamilyCount; ++family) {
+            VkQueueFlags flags = queueFamilies[family].queueFlags;
+            bool canTransfer = (flags & VK_QUEUE_TRANSFER_BIT) != 0;
+            if (queueFamilies[family].queueCount == 0 || !canTransfer ||
+                (flags & VK_QUEUE_GRAPHICS_BIT) != 0) {
+                continue;
+            }
+
+            int score = (flags & VK_QUEUE_COMPUTE_BIT) == 0 ? 2 : 1;
+            if (score > bestScore) {
+                bestScore = score;
+                indices.TransferFamily = family;
+                indices.TransferFamilyHasValue = true;
+            }
+        }
+        if (!indices.TransferFamilyHasValue && indices.GraphicsFamilyHasValue) {
+            indices.TransferFamily = indices.GraphicsFamily;
+            indices.TransferFamilyHasValue = true;
+        }
+
         return indices;
     }
 
@@ -491,6 +643,90 @@ namespace XIV::Render {
         }
     }
 
+    bool Device::IsInstanceExtensionAvailable(const char *name) {
+        u32 extensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+        return std::any_of(extensions.begin(), extensions.end(), [name](const auto &extension) {
+            return strcmp(extension.extensionName, name) == 0;
+        });
+    }
+
+    bool
+    Device::QueryBindlessSupport(VkPhysicalDeviceDescriptorIndexingFeaturesEXT &enabledFeatures) {
+        bool areExtensionsAvailable =
+            isProperties2Enabled &&
+            IsDeviceExtensionAvailable(physicalDevice, VK_KHR_MAINTENANCE3_EXTENSION_NAME) &&
+            IsDeviceExtensionAvailable(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        if (!areExtensionsAvailable) {
+            return false;
+        }
+
+        auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(
+            instance, "vkGetPhysicalDeviceFeatures2KHR");
+        auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(
+            instance, "vkGetPhysicalDeviceProperties2KHR");
+        if (getFeatures2 == nullptr || getProperties2 == nullptr) {
+            return false;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        VkPhysicalDeviceFeatures2KHR features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+        features2.pNext = &supported;
+        getFeatures2(physicalDevice, &features2);
+
+        bool isComplete = supported.runtimeDescriptorArray &&
+                          supported.descriptorBindingPartiallyBound &&
+                          supported.descriptorBindingUpdateUnusedWhilePending &&
+                          supported.descriptorBindingStorageBufferUpdateAfterBind &&
+                          supported.descriptorBindingSampledImageUpdateAfterBind &&
+                          supported.shaderStorageBufferArrayNonUniformIndexing &&
+                          supported.shaderSampledImageArrayNonUniformIndexing;
+        if (!isComplete) {
+            return false;
+        }
+
+        // Enable only what the bindless path uses.
+        enabledFeatures.runtimeDescriptorArray = VK_TRUE;
+        enabledFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        enabledFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        enabledFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        enabledFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        enabledFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        enabledFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+        VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+        indexingProperties.sType =
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2KHR properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+        properties2.pNext = &indexingProperties;
+        getProperties2(physicalDevice, &properties2);
+
+        // Every stage that reads the arrays counts against the per-stage limit.
+        bindlessLimits.MaxStorageBuffers =
+            std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                     indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers);
+        bindlessLimits.MaxSampledImages =
+            std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                     indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages);
+        return true;
+    }
+
+    bool Device::IsDeviceExtensionAvailable(VkPhysicalDevice device, const char *name) {
+        u32 extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(
+            device, nullptr, &extensionCount, extensions.data());
+        return std::any_of(extensions.begin(), extensions.end(), [name](const auto &extension) {
+            return strcmp(extension.extensionName, name) == 0;
+        });
+    }
+
     bool Device::CheckDeviceExtensionSupport(VkPhysicalDevice device) {
         u32 extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
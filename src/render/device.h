@@ -2,12 +2,21 @@
 #define DEVICE_H
 
 #include "core.h"
+#include "deletionqueue.h"
+#include "hostallocator.h"
+#include "layoutcache.h"
+#include "memoryallocator.h"
+#include "pipelinecache.h"
 #include "window.h"
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace XIV::Render {
+    class UploadContext;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR Capabilities;
         std::vector<VkSurfaceFormatKHR> Formats;
@@ -17,14 +26,23 @@ namespace XIV::Render {
     struct QueueFamilyIndices {
         u32 GraphicsFamily;
         u32 PresentFamily;
+        // A family without graphics when the device has one, else the graphics family.
+        u32 TransferFamily;
         bool GraphicsFamilyHasValue = false;
         bool PresentFamilyHasValue = false;
+        bool TransferFamilyHasValue = false;
 
         bool IsComplete() {
             return GraphicsFamilyHasValue && PresentFamilyHasValue;
         }
     };
 
+    // Array sizes an update-after-bind set may use, from VK_EXT_descriptor_indexing.
+    struct BindlessLimits {
+        u32 MaxStorageBuffers = 0;
+        u32 MaxSampledImages = 0;
+    };
+
     class Device {
     public:
 #ifdef DEBUG
@@ -49,6 +67,68 @@ namespace XIV::Render {
             return FindQueueFamilies(physicalDevice);
         }
 
+        // Every buffer and image allocates its memory through this.
+        MemoryAllocator &GetAllocator() {
+            return *allocator;
+        }
+
+        // Shared staging ring and fences for UploadBatch.
+        UploadContext &GetUploadContext();
+
+        // Allocation callbacks for every vkCreate* and vkDestroy*; null unless the build tracks
+        // host allocations.
+        const VkAllocationCallbacks *HostCallbacks() const {
+            return hostAllocator.Callbacks();
+        }
+
+        HostAllocator &GetHostAllocator() {
+            return hostAllocator;
+        }
+
+        // Shared descriptor set and pipeline layouts.
+        LayoutCache &GetLayoutCache() {
+            return *layoutCache;
+        }
+
+        // Every pipeline is created against this; it persists between runs.
+        PipelineCache &GetPipelineCache() {
+            return *pipelineCache;
+        }
+
+        // Where GPU resources go to be destroyed once frames in flight are done with them.
+        DeletionQueue &GetDeletionQueue() {
+            return *deletionQueue;
+        }
+
+        // Held around every submit and present. Queues allow one submitter at a time, and uploads
+        // can be submitted from worker threads while a frame is being submitted.
+        std::mutex &GetQueueMutex() {
+            return queueMutex;
+        }
+
+        // Snapshot of heap usage against budget, by allocation category. Cheap enough to take
+        // every frame; exact when VK_EXT_memory_budget is available.
+        MemoryBudget GetMemoryBudget();
+
+        bool IsMemoryBudgetSupported() const {
+            return getMemoryProperties2 != nullptr;
+        }
+
+        // True when VK_EXT_descriptor_indexing is enabled with partially bound, update-after-bind
+        // arrays of storage buffers and sampled images that shaders may index non-uniformly.
+        bool IsBindlessSupported() const {
+            return isBindlessSupported;
+        }
+
+        const BindlessLimits &GetBindlessLimits() const {
+            return bindlessLimits;
+        }
+
+        // VK_EXT_pipeline_creation_feedback, for telling pipeline cache hits from misses.
+        bool IsPipelineFeedbackSupported() const {
+            return isPipelineFeedbackSupported;
+        }
+
         u32 FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties);
         VkFormat FindSupportedFormat(const std::vector<VkFormat> &candidates,
                                      VkImageTiling tiling,
@@ -59,7 +139,13 @@ namespace XIV::Render {
                           VkBufferUsageFlags usage,
                           VkMemoryPropertyFlags properties,
                           VkBuffer &buffer,
-                          VkDeviceMemory &bufferMemory);
+                          MemoryAllocation &bufferMemory);
+        // Same, with the memory chosen by the allocator's MemoryPolicy.
+        void CreateBuffer(VkDeviceSize size,
+                          VkBufferUsageFlags usage,
+                          MemoryUsage memoryUsage,
+                          VkBuffer &buffer,
+                          MemoryAllocation &bufferMemory);
         VkCommandBuffer BeginSingleTimeCommands();
         void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
         void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,13 +154,15 @@ namespace XIV::Render {
         void CreateImageWithInfo(const VkImageCreateInfo &imageInfo,
                                  VkMemoryPropertyFlags properties,
                                  VkImage &image,
-                                 VkDeviceMemory &imageMemory);
+                                 MemoryAllocation &imageMemory);
 
         VkCommandPool CommandPool;
         VkDevice VulkanDevice;
         VkSurfaceKHR Surface;
         VkQueue GraphicsQueue;
         VkQueue PresentQueue;
+        // Same as GraphicsQueue when the device has no separate transfer family.
+        VkQueue TransferQueue;
         VkPhysicalDeviceProperties Properties;
 
     private:
@@ -98,10 +186,30 @@ namespace XIV::Render {
         void HasGflwRequiredInstanceExtensions();
         bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
         SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
-
+        bool IsInstanceExtensionAvailable(const char *name);
+        bool IsDeviceExtensionAvailable(VkPhysicalDevice device, const char *name);
+        bool QueryBindlessSupport(VkPhysicalDeviceDescriptorIndexingFeaturesEXT &enabledFeatures);
+        VkBuffer CreateBufferHandle(VkDeviceSize size,
+                                    VkBufferUsageFlags usage,
+                                    VkMemoryRequirements &memoryReqs);
+
+        // Outlives the instance, since members are destroyed after the destructor body.
+        HostAllocator hostAllocator;
         VkInstance instance;
         VkDebugUtilsMessengerEXT debugMessenger;
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        std::unique_ptr<MemoryAllocator> allocator;
+        std::unique_ptr<DeletionQueue> deletionQueue;
+        std::unique_ptr<LayoutCache> layoutCache;
+        std::unique_ptr<PipelineCache> pipelineCache;
+        std::unique_ptr<UploadContext> uploadContext;
+        std::mutex queueMutex;
+        bool isProperties2Enabled = false;
+        bool isBindlessSupported = false;
+        bool isPipelineFeedbackSupported = false;
+        BindlessLimits bindlessLimits{};
+        // Only loaded when VK_EXT_memory_budget is enabled.
+        PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
 
         Window &window;
     };
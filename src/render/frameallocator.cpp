@@ -0,0 +1,66 @@
+#include "frameallocator.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace XIV::Render {
+    FrameAllocator::FrameAllocator(Device &device, u32 frameCount, VkDeviceSize frameSize) {
+        const VkPhysicalDeviceLimits &limits = device.Properties.limits;
+        uniformAlignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+        storageAlignment = std::max<VkDeviceSize>(limits.minStorageBufferOffsetAlignment, 1);
+
+        // Dynamic offsets are 32-bit, so the whole buffer has to stay addressable by them.
+        buffer = std::make_unique<Buffer>(
+            device,
+            frameSize,
+            frameCount,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            MemoryUsage::Dynamic,
+            std::max(uniformAlignment, storageAlignment));
+        if (buffer->BufferSize > std::numeric_limits<u32>::max()) {
+            throw std::runtime_error("Frame allocator is too large for dynamic offsets.");
+        }
+        buffer->Map();
+        BeginFrame(0);
+    }
+
+    FrameAllocator::~FrameAllocator() {}
+
+    void FrameAllocator::BeginFrame(u32 frameIndex) {
+        frameBegin = buffer->AlignmentSize * frameIndex;
+        frameEnd = frameBegin + buffer->InstanceSize;
+        head = frameBegin;
+    }
+
+    void FrameAllocator::Flush() {
+        if (head > frameBegin) {
+            buffer->Flush(head - frameBegin, frameBegin);
+        }
+    }
+
+    FrameAllocator::Allocation FrameAllocator::AllocateUniform(VkDeviceSize size) {
+        return Allocate(size, uniformAlignment);
+    }
+
+    FrameAllocator::Allocation FrameAllocator::AllocateStorage(VkDeviceSize size) {
+        return Allocate(size, storageAlignment);
+    }
+
+    FrameAllocator::Allocation FrameAllocator::Allocate(VkDeviceSize size,
+                                                        VkDeviceSize alignment) {
+        // Device alignment limits are powers of two.
+        VkDeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+        if (offset + size > frameEnd) {
+            throw std::runtime_error("Frame allocator ran out of space for this frame.");
+        }
+        head = offset + size;
+
+        Allocation allocation{};
+        allocation.Buffer = buffer->VulkanBuffer;
+        allocation.Offset = static_cast<u32>(offset);
+        allocation.Size = size;
+        allocation.Mapped = static_cast<u8 *>(buffer->Mapped) + offset;
+        return allocation;
+    }
+} // namespace XIV::Render
\ No newline at end of file
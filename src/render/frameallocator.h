@@ -0,0 +1,75 @@
+#ifndef FRAME_ALLOCATOR_H
+#define FRAME_ALLOCATOR_H
+
+#include "buffer.h"
+#include "core.h"
+#include "device.h"
+
+#include <memory>
+
+namespace XIV::Render {
+    // Hands out per-frame uniform and storage data from one persistently mapped buffer, split
+    // into a region per frame in flight. Allocation is a pointer bump, so systems can push
+    // per-pass and per-draw data every frame and bind it through a dynamic descriptor offset
+    // instead of creating buffers or descriptor sets. With resizable BAR or unified memory the
+    // buffer lives in device memory, so shaders read it without crossing the bus.
+    //
+    // Not thread-safe; allocate from the thread that records the frame.
+    class FrameAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4ull * 1024 * 1024;
+
+        struct Allocation {
+            VkBuffer Buffer = VK_NULL_HANDLE;
+            // Pass to vkCmdBindDescriptorSets as the dynamic offset.
+            u32 Offset = 0;
+            VkDeviceSize Size = 0;
+            void *Mapped = nullptr;
+        };
+
+        FrameAllocator(Device &device,
+                       u32 frameCount,
+                       VkDeviceSize frameSize = DEFAULT_FRAME_SIZE);
+        ~FrameAllocator();
+        FrameAllocator(const FrameAllocator &) = delete;
+        FrameAllocator &operator=(const FrameAllocator &) = delete;
+
+        // Starts allocating from frameIndex's region. Only call once the GPU is done with the
+        // last frame that used that index.
+        void BeginFrame(u32 frameIndex);
+        // Makes this frame's writes visible to the device. A no-op for coherent memory.
+        void Flush();
+
+        Allocation AllocateUniform(VkDeviceSize size);
+        Allocation AllocateStorage(VkDeviceSize size);
+
+        template <typename T>
+        Allocation PushUniform(const T &data) {
+            Allocation allocation = AllocateUniform(sizeof(T));
+            *static_cast<T *>(allocation.Mapped) = data;
+            return allocation;
+        }
+
+        // Descriptor info for a UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC binding. range
+        // is the size the shader reads at each dynamic offset.
+        VkDescriptorBufferInfo DescriptorInfo(VkDeviceSize range) const {
+            return VkDescriptorBufferInfo{buffer->VulkanBuffer, 0, range};
+        }
+
+        VkDeviceSize UsedBytes() const {
+            return head - frameBegin;
+        }
+
+    private:
+        Allocation Allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+        std::unique_ptr<Buffer> buffer;
+        VkDeviceSize uniformAlignment = 1;
+        VkDeviceSize storageAlignment = 1;
+        VkDeviceSize frameBegin = 0;
+        VkDeviceSize frameEnd = 0;
+        VkDeviceSize head = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
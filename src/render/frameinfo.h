@@ -1,7 +1,11 @@
 #ifndef FRAME_INFO_H
 #define FRAME_INFO_H
 
+#include "bindlesstable.h"
 #include "camera.h"
+#include "descriptors.h"
+#include "framearena.h"
+#include "frameallocator.h"
 #include "gameobject.h"
 
 #include <vulkan/vulkan.h>
@@ -29,6 +33,15 @@ namespace XIV::Render {
         VkCommandBuffer CommandBuffer;
         Camera &Camera;
         VkDescriptorSet GlobalDescriptorSet;
+        // Dynamic offset of this frame's GlobalUbo, for binding GlobalDescriptorSet.
+        u32 GlobalUboOffset;
+        FrameAllocator &FrameAllocator;
+        // CPU scratch for containers that only live this frame.
+        FrameArena &Scratch;
+        // Sets written for this frame only; reset when the frame index comes around again.
+        FrameDescriptorAllocator &FrameDescriptors;
+        // Null unless the device supports descriptor indexing.
+        BindlessTable *Bindless;
         GameObject::Map &GameObjects;
     };
 } // namespace XIV::Render
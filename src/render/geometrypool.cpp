@@ -0,0 +1,446 @@
+#include "geometrypool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace XIV::Render {
+    GeometryPool::GeometryPool(Device &device, VkDeviceSize blockBytes)
+        : device{device}, blockBytes{blockBytes} {}
+
+    GeometryPool::~GeometryPool() {
+        // Deferred frees of models drawn from this pool must run while it still exists.
+        vkDeviceWaitIdle(device.VulkanDevice);
+        device.GetDeletionQueue().Flush();
+    }
+
+    GeometryPool::Allocation
+    GeometryPool::Allocate(u32 vertexStride, u32 vertexCount, u32 indexSize, u32 indexCount) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        Allocation allocation{};
+        allocation.Id = nextId++;
+        allocation.VertexStride = vertexStride;
+        allocation.VertexCount = vertexCount;
+        Arena &vertexArena = GetArena(vertexArenas,
+                                      vertexStride,
+                                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+        AllocateLocked(vertexArena, vertexCount, allocation.VertexBlock, allocation.VertexOffset);
+        allocation.VertexStorage = vertexArena.Blocks[allocation.VertexBlock].Storage.get();
+        allocation.VertexBuffer = allocation.VertexStorage->VulkanBuffer;
+
+        if (indexCount > 0) {
+            allocation.IndexSize = indexSize;
+            allocation.IndexCount = indexCount;
+            Arena &indexArena = GetArena(indexArenas,
+                                         indexSize,
+                                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                             VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+            try {
+                AllocateLocked(
+                    indexArena, indexCount, allocation.IndexBlock, allocation.FirstIndex);
+            } catch (...) {
+                FreeLocked(
+                    vertexArena, allocation.VertexBlock, allocation.VertexOffset, vertexCount);
+                throw;
+            }
+            allocation.IndexStorage = indexArena.Blocks[allocation.IndexBlock].Storage.get();
+            allocation.IndexBuffer = allocation.IndexStorage->VulkanBuffer;
+        }
+
+        ++allocationCount;
+        usedBytes += allocation.Bytes();
+        return allocation;
+    }
+
+    void GeometryPool::Free(const Allocation &allocation) {
+        if (allocation.VertexBuffer == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        relocatables.erase(allocation.Id);
+        FreeLocked(vertexArenas.at(allocation.VertexStride),
+                   allocation.VertexBlock,
+                   allocation.VertexOffset,
+                   allocation.VertexCount);
+        if (allocation.IndexBuffer != VK_NULL_HANDLE) {
+            FreeLocked(indexArenas.at(allocation.IndexSize),
+                       allocation.IndexBlock,
+                       allocation.FirstIndex,
+                       allocation.IndexCount);
+        }
+
+        --allocationCount;
+        usedBytes -= allocation.Bytes();
+    }
+
+    void GeometryPool::SetRelocatable(const Allocation &allocation, RelocateFn onRelocate) {
+        std::lock_guard<std::mutex> lock{mutex};
+        relocatables[allocation.Id] = Relocatable{allocation, std::move(onRelocate)};
+    }
+
+    void GeometryPool::ClearRelocatable(u64 id) {
+        std::lock_guard<std::mutex> lock{mutex};
+        relocatables.erase(id);
+    }
+
+    GeometryPool::DefragStats
+    GeometryPool::Defragment(VkCommandBuffer commandBuffer, u32 maxMoves, VkDeviceSize maxBytes) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        DefragStats stats{};
+        stats.FragmentationBefore = FragmentationLocked();
+
+        // One movable range: the vertex or the index half of a relocatable allocation.
+        struct Candidate {
+            Relocatable *Owner;
+            bool IsIndex;
+            Arena *SourceArena;
+            u32 Block;
+            u32 Offset;
+            u32 Count;
+            u32 BlockFree;
+        };
+        std::vector<Candidate> candidates;
+        for (auto &kv : relocatables) {
+            Allocation &current = kv.second.Current;
+            Arena &vertexArena = vertexArenas.at(current.VertexStride);
+            candidates.push_back({&kv.second,
+                                  false,
+                                  &vertexArena,
+                                  current.VertexBlock,
+                                  current.VertexOffset,
+                                  current.VertexCount,
+                                  vertexArena.Blocks[current.VertexBlock].FreeCount()});
+            if (current.IndexBuffer != VK_NULL_HANDLE) {
+                Arena &indexArena = indexArenas.at(current.IndexSize);
+                candidates.push_back({&kv.second,
+                                      true,
+                                      &indexArena,
+                                      current.IndexBlock,
+                                      current.FirstIndex,
+                                      current.IndexCount,
+                                      indexArena.Blocks[current.IndexBlock].FreeCount()});
+            }
+        }
+
+        // Drain the emptiest blocks first, and the highest ranges within a block.
+        std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) {
+            if (a.BlockFree != b.BlockFree) {
+                return a.BlockFree > b.BlockFree;
+            }
+            return a.Offset > b.Offset;
+        });
+
+        bool isRecording = false;
+        for (const Candidate &candidate : candidates) {
+            if (stats.Moves >= maxMoves || stats.BytesMoved >= maxBytes) {
+                break;
+            }
+
+            Arena &arena = *candidate.SourceArena;
+            u32 dstBlock = 0;
+            u32 dstOffset = 0;
+            if (!FindDestinationLocked(arena,
+                                       candidate.Block,
+                                       candidate.Offset,
+                                       candidate.Count,
+                                       dstBlock,
+                                       dstOffset)) {
+                continue;
+            }
+
+            if (!isRecording) {
+                // Uploads and earlier frames' draws must be done with the ranges first.
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT |
+                                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     0,
+                                     1,
+                                     &barrier,
+                                     0,
+                                     nullptr,
+                                     0,
+                                     nullptr);
+                isRecording = true;
+            }
+
+            Buffer *source = arena.Blocks[candidate.Block].Storage.get();
+            Buffer *destination = arena.Blocks[dstBlock].Storage.get();
+            VkBufferCopy region{};
+            region.srcOffset = static_cast<VkDeviceSize>(arena.ElementSize) * candidate.Offset;
+            region.dstOffset = static_cast<VkDeviceSize>(arena.ElementSize) * dstOffset;
+            region.size = static_cast<VkDeviceSize>(arena.ElementSize) * candidate.Count;
+            vkCmdCopyBuffer(
+                commandBuffer, source->VulkanBuffer, destination->VulkanBuffer, 1, &region);
+
+            Allocation &current = candidate.Owner->Current;
+            if (candidate.IsIndex) {
+                current.IndexBlock = dstBlock;
+                current.FirstIndex = dstOffset;
+                current.IndexStorage = destination;
+                current.IndexBuffer = destination->VulkanBuffer;
+            } else {
+                current.VertexBlock = dstBlock;
+                current.VertexOffset = dstOffset;
+                current.VertexStorage = destination;
+                current.VertexBuffer = destination->VulkanBuffer;
+            }
+            candidate.Owner->OnRelocate(current);
+
+            // Frames in flight, and the copy itself, still read the old range.
+            Arena *sourceArena = &arena;
+            u32 block = candidate.Block;
+            u32 offset = candidate.Offset;
+            u32 count = candidate.Count;
+            device.GetDeletionQueue().Enqueue([this, sourceArena, block, offset, count]() {
+                std::lock_guard<std::mutex> lock{mutex};
+                FreeLocked(*sourceArena, block, offset, count);
+            });
+
+            ++stats.Moves;
+            stats.BytesMoved += region.size;
+        }
+
+        if (isRecording) {
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                 0,
+                                 1,
+                                 &barrier,
+                                 0,
+                                 nullptr,
+                                 0,
+                                 nullptr);
+        }
+
+        for (auto *arenas : {&vertexArenas, &indexArenas}) {
+            for (auto &kv : *arenas) {
+                stats.BlocksReleased += ReleaseEmptyBlocksLocked(kv.second);
+            }
+        }
+        stats.FragmentationAfter = FragmentationLocked();
+
+        if (defragPasses++ == 0) {
+            defragTotals.FragmentationBefore = stats.FragmentationBefore;
+        }
+        defragTotals.Moves += stats.Moves;
+        defragTotals.BytesMoved += stats.BytesMoved;
+        defragTotals.BlocksReleased += stats.BlocksReleased;
+        defragTotals.FragmentationAfter = stats.FragmentationAfter;
+        return stats;
+    }
+
+    GeometryPool::DefragStats GeometryPool::GetDefragTotals() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return defragTotals;
+    }
+
+    void GeometryPool::PrintDefragStats(std::ostream &out) const {
+        DefragStats totals = GetDefragTotals();
+        Stats current = GetStats();
+        out << "Geometry pool: " << totals.Moves << " moves, " << totals.BytesMoved
+            << " bytes moved, " << totals.BlocksReleased << " blocks released, fragmentation "
+            << totals.FragmentationBefore << " -> " << totals.FragmentationAfter << " ("
+            << current.Fragmentation << " now)" << std::endl;
+    }
+
+    GeometryPool::Stats GeometryPool::GetStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        Stats stats{};
+        stats.AllocationCount = allocationCount;
+        stats.UsedBytes = usedBytes;
+        stats.Fragmentation = FragmentationLocked();
+        for (const auto *arenas : {&vertexArenas, &indexArenas}) {
+            for (const auto &kv : *arenas) {
+                for (const Block &block : kv.second.Blocks) {
+                    if (block.Storage != nullptr) {
+                        ++stats.BlockCount;
+                        stats.CapacityBytes += block.Storage->BufferSize;
+                    }
+                }
+            }
+        }
+        return stats;
+    }
+
+    GeometryPool::Arena &GeometryPool::GetArena(std::unordered_map<u32, Arena> &arenas,
+                                                u32 elementSize,
+                                                VkBufferUsageFlags usage) {
+        Arena &arena = arenas[elementSize];
+        arena.ElementSize = elementSize;
+        arena.Usage = usage;
+        return arena;
+    }
+
+    void GeometryPool::AllocateLocked(Arena &arena, u32 count, u32 &block, u32 &offset) {
+        size_t emptySlot = arena.Blocks.size();
+        for (size_t b = 0; b < arena.Blocks.size(); ++b) {
+            if (arena.Blocks[b].Storage == nullptr) {
+                emptySlot = std::min(emptySlot, b);
+                continue;
+            }
+            auto &ranges = arena.Blocks[b].FreeRanges;
+            auto it = std::find_if(ranges.begin(), ranges.end(), [count](const auto &range) {
+                return range.second >= count;
+            });
+            if (it == ranges.end()) {
+                continue;
+            }
+
+            block = static_cast<u32>(b);
+            offset = it->first;
+            TakeRange(ranges, it, count);
+            return;
+        }
+
+        // Nothing fits; grow by one block, or by exactly the mesh if it is larger than a block.
+        VkDeviceSize blockElements = std::max<VkDeviceSize>(blockBytes / arena.ElementSize, 1);
+        Block newBlock{};
+        newBlock.Capacity = static_cast<u32>(std::max<VkDeviceSize>(blockElements, count));
+        newBlock.Storage = std::make_unique<Buffer>(device,
+                                                    arena.ElementSize,
+                                                    newBlock.Capacity,
+                                                    arena.Usage,
+                                                    MemoryUsage::GpuOnly);
+        // Mapped once here, so threads writing meshes never race on the mapping.
+        if (newBlock.Storage->IsHostVisible()) {
+            newBlock.Storage->Map();
+        }
+        if (newBlock.Capacity > count) {
+            newBlock.FreeRanges.emplace(count, newBlock.Capacity - count);
+        }
+        if (emptySlot == arena.Blocks.size()) {
+            arena.Blocks.emplace_back();
+        }
+        arena.Blocks[emptySlot] = std::move(newBlock);
+
+        block = static_cast<u32>(emptySlot);
+        offset = 0;
+    }
+
+    void GeometryPool::FreeLocked(Arena &arena, u32 block, u32 offset, u32 count) {
+        if (count == 0) {
+            return;
+        }
+
+        // Merge with the free neighbors on either side so ranges do not splinter.
+        auto &ranges = arena.Blocks[block].FreeRanges;
+        auto next = ranges.lower_bound(offset);
+        if (next != ranges.end() && offset + count == next->first) {
+            count += next->second;
+            next = ranges.erase(next);
+        }
+        if (next != ranges.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == offset) {
+                previous->second += count;
+                return;
+            }
+        }
+        ranges.emplace(offset, count);
+    }
+
+    void GeometryPool::TakeRange(std::map<u32, u32> &ranges,
+                                 std::map<u32, u32>::iterator range,
+                                 u32 count) {
+        u32 offset = range->first;
+        u32 remaining = range->second - count;
+        ranges.erase(range);
+        if (remaining > 0) {
+            ranges.emplace(offset + count, remaining);
+        }
+    }
+
+    bool GeometryPool::FindDestinationLocked(
+        Arena &arena, u32 block, u32 offset, u32 count, u32 &dstBlock, u32 &dstOffset) {
+        // Fullest blocks first, so data flows toward the blocks that are staying.
+        u32 sourceFree = arena.Blocks[block].FreeCount();
+        std::vector<std::pair<u32, u32>> targets; // free count, block
+        for (u32 b = 0; b < arena.Blocks.size(); ++b) {
+            if (arena.Blocks[b].Storage == nullptr) {
+                continue;
+            }
+            u32 free = arena.Blocks[b].FreeCount();
+            if (b == block || free < sourceFree) {
+                targets.emplace_back(free, b);
+            }
+        }
+        std::sort(targets.begin(), targets.end());
+
+        for (const auto &target : targets) {
+            auto &ranges = arena.Blocks[target.second].FreeRanges;
+            for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+                // Within the source block, only moving down closes a hole.
+                if (target.second == block && it->first >= offset) {
+                    break;
+                }
+                if (it->second < count) {
+                    continue;
+                }
+                dstBlock = target.second;
+                dstOffset = it->first;
+                TakeRange(ranges, it, count);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    u32 GeometryPool::ReleaseEmptyBlocksLocked(Arena &arena) {
+        // The first live block stays even when empty, so a load/unload cycle does not churn.
+        u32 released = 0;
+        bool isFirst = true;
+        for (Block &block : arena.Blocks) {
+            if (block.Storage == nullptr) {
+                continue;
+            }
+            if (isFirst) {
+                isFirst = false;
+                continue;
+            }
+            if (block.FreeCount() == block.Capacity) {
+                // The Buffer defers its own destruction past the frames in flight.
+                block = Block{};
+                ++released;
+            }
+        }
+        return released;
+    }
+
+    float GeometryPool::FragmentationLocked() const {
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestBytes = 0;
+        for (const auto *arenas : {&vertexArenas, &indexArenas}) {
+            for (const auto &kv : *arenas) {
+                u32 largest = 0;
+                for (const Block &block : kv.second.Blocks) {
+                    for (const auto &range : block.FreeRanges) {
+                        freeBytes += static_cast<VkDeviceSize>(range.second) * kv.first;
+                        largest = std::max(largest, range.second);
+                    }
+                }
+                largestBytes += static_cast<VkDeviceSize>(largest) * kv.first;
+            }
+        }
+        if (freeBytes == 0) {
+            return 0.0f;
+        }
+        return 1.0f - static_cast<float>(largestBytes) / static_cast<float>(freeBytes);
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,170 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include "buffer.h"
+#include "core.h"
+#include "device.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace XIV::Render {
+    // Suballocates meshes out of a few large device-local vertex and index buffers, so models
+    // that share a vertex format and index size also share their bindings. Each vertex stride
+    // and index size gets its own arena of blocks, which keeps offsets in whole elements. On
+    // unified memory the blocks stay mapped and meshes are written into them directly.
+    //
+    // Long sessions leave holes behind as meshes come and go. Defragment moves meshes whose
+    // owners allow it into those holes a few at a time, and releases blocks that empty out.
+    class GeometryPool {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_BYTES = 64ull * 1024 * 1024;
+        static constexpr u32 DEFAULT_DEFRAG_MOVES = 8;
+        static constexpr VkDeviceSize DEFAULT_DEFRAG_BYTES = 4ull * 1024 * 1024;
+
+        // One mesh's share of the pool. Offsets count vertices and indices rather than bytes, so
+        // they go straight into vkCmdDrawIndexed.
+        struct Allocation {
+            u64 Id = 0;
+            VkBuffer VertexBuffer = VK_NULL_HANDLE;
+            Buffer *VertexStorage = nullptr; // the block, for UploadBatch::WriteToBuffer
+            u32 VertexStride = 0;
+            u32 VertexBlock = 0;
+            u32 VertexOffset = 0;
+            u32 VertexCount = 0;
+
+            VkBuffer IndexBuffer = VK_NULL_HANDLE; // null when the mesh has no indices
+            Buffer *IndexStorage = nullptr;
+            u32 IndexSize = 0;
+            u32 IndexBlock = 0;
+            u32 FirstIndex = 0;
+            u32 IndexCount = 0;
+
+            VkDeviceSize Bytes() const {
+                return static_cast<VkDeviceSize>(VertexStride) * VertexCount +
+                       static_cast<VkDeviceSize>(IndexSize) * IndexCount;
+            }
+        };
+
+        struct Stats {
+            size_t BlockCount = 0;
+            size_t AllocationCount = 0;
+            VkDeviceSize CapacityBytes = 0;
+            VkDeviceSize UsedBytes = 0;
+            // 1 - largest free range / free space, in bytes over all arenas. Zero when every
+            // arena's free space is contiguous.
+            float Fragmentation = 0.0f;
+        };
+
+        // FragmentationAfter still counts moved-from ranges as used; they are freed once the
+        // frames in flight are done with them, so it catches up over the next frames.
+        struct DefragStats {
+            u32 Moves = 0;
+            VkDeviceSize BytesMoved = 0;
+            u32 BlocksReleased = 0;
+            float FragmentationBefore = 0.0f;
+            float FragmentationAfter = 0.0f;
+        };
+
+        // Receives the allocation's new location after Defragment moved it.
+        using RelocateFn = std::function<void(const Allocation &)>;
+
+        GeometryPool(Device &device, VkDeviceSize blockBytes = DEFAULT_BLOCK_BYTES);
+        ~GeometryPool();
+        GeometryPool(const GeometryPool &) = delete;
+        GeometryPool &operator=(const GeometryPool &) = delete;
+
+        // Reserves room for a mesh, adding a block when no free range is large enough. Meshes
+        // bigger than a block get a block of their own. Safe to call from any thread.
+        Allocation Allocate(u32 vertexStride, u32 vertexCount, u32 indexSize, u32 indexCount);
+        // Returns the ranges to their blocks. The GPU must be done reading them, since the next
+        // allocation may overwrite them; Model defers this through the device's DeletionQueue.
+        // Emptied blocks are only released by Defragment.
+        void Free(const Allocation &allocation);
+
+        // Lets Defragment move the allocation. Only call once its upload has completed.
+        // onRelocate runs on the thread calling Defragment, with the pool locked.
+        void SetRelocatable(const Allocation &allocation, RelocateFn onRelocate);
+        // Pins the allocation again. Once this returns, its onRelocate is never called again.
+        void ClearRelocatable(u64 id);
+
+        // Records up to maxMoves copies (about maxBytes in total) into commandBuffer, which
+        // must be outside a render pass. They move relocatable meshes out of the emptiest
+        // blocks, and into lower holes within a block. Owners are patched right away, so
+        // draws recorded later in the same command buffer already use the new location. Old
+        // ranges go through the device's DeletionQueue, and blocks that are left empty are
+        // released.
+        DefragStats Defragment(VkCommandBuffer commandBuffer,
+                               u32 maxMoves = DEFAULT_DEFRAG_MOVES,
+                               VkDeviceSize maxBytes = DEFAULT_DEFRAG_BYTES);
+
+        Stats GetStats() const;
+        // Every Defragment so far added up. FragmentationBefore is from the first pass and
+        // FragmentationAfter from the latest.
+        DefragStats GetDefragTotals() const;
+        void PrintDefragStats(std::ostream &out) const;
+
+    private:
+        // Released blocks keep their slot with a null Storage, so block indices stay valid.
+        struct Block {
+            std::unique_ptr<Buffer> Storage{};
+            u32 Capacity = 0;
+            std::map<u32, u32> FreeRanges{}; // offset -> count, in elements
+
+            u32 FreeCount() const {
+                u32 count = 0;
+                for (const auto &range : FreeRanges) {
+                    count += range.second;
+                }
+                return count;
+            }
+        };
+
+        struct Arena {
+            u32 ElementSize = 0;
+            VkBufferUsageFlags Usage = 0;
+            std::vector<Block> Blocks{};
+        };
+
+        Arena &GetArena(std::unordered_map<u32, Arena> &arenas,
+                        u32 elementSize,
+                        VkBufferUsageFlags usage);
+        // First fit across the arena's blocks; returns the block index and element offset.
+        void AllocateLocked(Arena &arena, u32 count, u32 &block, u32 &offset);
+        void FreeLocked(Arena &arena, u32 block, u32 offset, u32 count);
+        // Takes count elements from the front of a free range.
+        static void
+        TakeRange(std::map<u32, u32> &ranges, std::map<u32, u32>::iterator range, u32 count);
+        // A destination for a range of count elements at block/offset: a fuller block, or a
+        // lower offset in the same one. Returns false when moving would not help.
+        bool FindDestinationLocked(
+            Arena &arena, u32 block, u32 offset, u32 count, u32 &dstBlock, u32 &dstOffset);
+        u32 ReleaseEmptyBlocksLocked(Arena &arena);
+        float FragmentationLocked() const;
+
+        struct Relocatable {
+            Allocation Current{};
+            RelocateFn OnRelocate{};
+        };
+
+        Device &device;
+        VkDeviceSize blockBytes;
+
+        mutable std::mutex mutex;
+        std::unordered_map<u32, Arena> vertexArenas;
+        std::unordered_map<u32, Arena> indexArenas;
+        std::unordered_map<u64, Relocatable> relocatables;
+        u64 nextId = 1;
+        size_t allocationCount = 0;
+        VkDeviceSize usedBytes = 0;
+        DefragStats defragTotals{};
+        u32 defragPasses = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
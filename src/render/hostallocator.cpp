@@ -0,0 +1,305 @@
+#include "hostallocator.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+
+namespace XIV::Render {
+    namespace {
+        constexpr u32 NOT_POOLED = ~0u;
+        // Slot sizes, header included. Larger or over-aligned requests go to the heap.
+        constexpr size_t SLOT_SIZES[] = {64, 128, 256, 512};
+        constexpr u32 SLOT_SIZE_COUNT = static_cast<u32>(std::size(SLOT_SIZES));
+        constexpr size_t SLAB_BYTES = 64 * 1024;
+
+        const char *ScopeName(size_t scope) {
+            switch (scope) {
+            case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+                return "command";
+            case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+                return "object";
+            case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+                return "cache";
+            case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+                return "device";
+            case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+                return "instance";
+            }
+            return "unknown";
+        }
+
+        const char *ObjectTypeName(VkObjectType type) {
+            switch (type) {
+            case VK_OBJECT_TYPE_INSTANCE:
+                return "instance";
+            case VK_OBJECT_TYPE_DEVICE:
+                return "device";
+            case VK_OBJECT_TYPE_SEMAPHORE:
+                return "semaphore";
+            case VK_OBJECT_TYPE_FENCE:
+                return "fence";
+            case VK_OBJECT_TYPE_BUFFER:
+                return "buffer";
+            case VK_OBJECT_TYPE_DEVICE_MEMORY:
+                return "device memory";
+            case VK_OBJECT_TYPE_IMAGE:
+                return "image";
+            case VK_OBJECT_TYPE_IMAGE_VIEW:
+                return "image view";
+            case VK_OBJECT_TYPE_SHADER_MODULE:
+                return "shader module";
+            case VK_OBJECT_TYPE_PIPELINE_CACHE:
+                return "pipeline cache";
+            case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+                return "pipeline layout";
+            case VK_OBJECT_TYPE_RENDER_PASS:
+                return "render pass";
+            case VK_OBJECT_TYPE_PIPELINE:
+                return "pipeline";
+            case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+                return "descriptor set layout";
+            case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+                return "descriptor pool";
+            case VK_OBJECT_TYPE_FRAMEBUFFER:
+                return "framebuffer";
+            case VK_OBJECT_TYPE_COMMAND_POOL:
+                return "command pool";
+            case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+                return "swapchain";
+            default:
+                return "other";
+            }
+        }
+    } // namespace
+
+    // Sits right before every pointer handed to the driver.
+    struct alignas(16) HostAllocator::Header {
+        size_t Size;
+        size_t Offset; // from the start of the heap block or pool slot
+        u32 Pool;
+        VkObjectType ObjectType;
+        VkSystemAllocationScope Scope;
+    };
+
+    struct HostAllocator::Pool {
+        size_t SlotSize = 0;
+        std::vector<std::unique_ptr<std::byte[]>> Slabs{};
+        std::vector<std::byte *> FreeSlots{};
+
+        void Grow() {
+            // new[] is aligned for any fundamental type, and slot sizes keep that alignment.
+            Slabs.push_back(std::make_unique<std::byte[]>(SLAB_BYTES));
+            std::byte *slab = Slabs.back().get();
+            for (size_t offset = 0; offset + SlotSize <= SLAB_BYTES; offset += SlotSize) {
+                FreeSlots.push_back(slab + offset);
+            }
+        }
+    };
+
+    thread_local VkObjectType HostAllocator::currentObjectType = VK_OBJECT_TYPE_UNKNOWN;
+
+    HostAllocator::HostAllocator() {
+        callbacks.pUserData = this;
+        callbacks.pfnAllocation = &HostAllocator::Allocation;
+        callbacks.pfnReallocation = &HostAllocator::Reallocation;
+        callbacks.pfnFree = &HostAllocator::Free;
+        callbacks.pfnInternalAllocation = &HostAllocator::InternalAllocation;
+        callbacks.pfnInternalFree = &HostAllocator::InternalFree;
+
+        // Command scope first, then object scope.
+        for (u32 scope = 0; scope < 2; ++scope) {
+            for (size_t slotSize : SLOT_SIZES) {
+                auto pool = std::make_unique<Pool>();
+                pool->SlotSize = slotSize;
+                pools.push_back(std::move(pool));
+            }
+        }
+    }
+
+    HostAllocator::~HostAllocator() = default;
+
+    HostAllocationReport HostAllocator::GetReport() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return report;
+    }
+
+    void HostAllocator::PrintReport(std::ostream &out) const {
+        HostAllocationReport snapshot = GetReport();
+
+        auto print = [&out](const char *name, const HostAllocationCounters &counters) {
+            out << "  " << name << ": " << counters.Allocations << " allocs, "
+                << counters.Reallocations << " reallocs, " << counters.Frees << " frees, "
+                << counters.TotalBytes << " bytes total, " << counters.PeakBytes << " peak, "
+                << counters.LiveBytes << " live" << std::endl;
+        };
+
+        out << "Host allocations by scope (" << snapshot.PooledAllocations
+            << " pooled, " << snapshot.InternalBytes << " internal bytes):" << std::endl;
+        for (size_t scope = 0; scope < HOST_ALLOCATION_SCOPE_COUNT; ++scope) {
+            print(ScopeName(scope), snapshot.Scopes[scope]);
+        }
+        out << "Host allocations by object type:" << std::endl;
+        for (const auto &kv : snapshot.ObjectTypes) {
+            print(ObjectTypeName(kv.first), kv.second);
+        }
+    }
+
+    void *HostAllocator::Allocation(void *userData,
+                                    size_t size,
+                                    size_t alignment,
+                                    VkSystemAllocationScope scope) {
+        auto *allocator = static_cast<HostAllocator *>(userData);
+        std::lock_guard<std::mutex> lock{allocator->mutex};
+        return allocator->AllocateLocked(size, alignment, scope);
+    }
+
+    void *HostAllocator::Reallocation(void *userData,
+                                      void *original,
+                                      size_t size,
+                                      size_t alignment,
+                                      VkSystemAllocationScope scope) {
+        auto *allocator = static_cast<HostAllocator *>(userData);
+        std::lock_guard<std::mutex> lock{allocator->mutex};
+        if (original == nullptr) {
+            return allocator->AllocateLocked(size, alignment, scope);
+        }
+        if (size == 0) {
+            allocator->FreeLocked(original);
+            return nullptr;
+        }
+
+        auto *header =
+            reinterpret_cast<Header *>(static_cast<std::byte *>(original) - sizeof(Header));
+        HostAllocationReport &report = allocator->report;
+        ++report.Scopes[header->Scope].Reallocations;
+        ++report.ObjectTypes[header->ObjectType].Reallocations;
+
+        // A pool slot often has room to grow in place.
+        if (header->Pool != NOT_POOLED &&
+            size + sizeof(Header) <= allocator->pools[header->Pool]->SlotSize) {
+            for (HostAllocationCounters *counters :
+                 {&report.Scopes[header->Scope], &report.ObjectTypes[header->ObjectType]}) {
+                counters->LiveBytes = counters->LiveBytes - header->Size + size;
+                counters->PeakBytes = std::max(counters->PeakBytes, counters->LiveBytes);
+            }
+            header->Size = size;
+            return original;
+        }
+
+        void *memory = allocator->AllocateLocked(size, alignment, scope);
+        if (memory == nullptr) {
+            return nullptr;
+        }
+        std::memcpy(memory, original, std::min(size, header->Size));
+        allocator->FreeLocked(original);
+        return memory;
+    }
+
+    void HostAllocator::Free(void *userData, void *memory) {
+        if (memory == nullptr) {
+            return;
+        }
+        auto *allocator = static_cast<HostAllocator *>(userData);
+        std::lock_guard<std::mutex> lock{allocator->mutex};
+        allocator->FreeLocked(memory);
+    }
+
+    void HostAllocator::InternalAllocation(void *userData,
+                                           size_t size,
+                                           VkInternalAllocationType,
+                                           VkSystemAllocationScope) {
+        auto *allocator = static_cast<HostAllocator *>(userData);
+        std::lock_guard<std::mutex> lock{allocator->mutex};
+        allocator->report.InternalBytes += size;
+    }
+
+    void HostAllocator::InternalFree(void *userData,
+                                     size_t size,
+                                     VkInternalAllocationType,
+                                     VkSystemAllocationScope) {
+        auto *allocator = static_cast<HostAllocator *>(userData);
+        std::lock_guard<std::mutex> lock{allocator->mutex};
+        allocator->report.InternalBytes -= size;
+    }
+
+    void *HostAllocator::AllocateLocked(size_t size,
+                                        size_t alignment,
+                                        VkSystemAllocationScope scope) {
+        if (size == 0) {
+            return nullptr;
+        }
+
+        u32 poolIndex = NOT_POOLED;
+        if (scope <= VK_SYSTEM_ALLOCATION_SCOPE_OBJECT && alignment <= alignof(Header)) {
+            for (u32 i = 0; i < SLOT_SIZE_COUNT; ++i) {
+                if (size + sizeof(Header) <= SLOT_SIZES[i]) {
+                    poolIndex = static_cast<u32>(scope) * SLOT_SIZE_COUNT + i;
+                    break;
+                }
+            }
+        }
+
+        std::byte *block = nullptr;
+        std::byte *payload = nullptr;
+        if (poolIndex != NOT_POOLED) {
+            Pool &pool = *pools[poolIndex];
+            if (pool.FreeSlots.empty()) {
+                pool.Grow();
+            }
+            block = pool.FreeSlots.back();
+            pool.FreeSlots.pop_back();
+            payload = block + sizeof(Header);
+            ++report.PooledAllocations;
+        } else {
+            size_t blockAlignment = std::max(alignment, alignof(Header));
+            block = static_cast<std::byte *>(
+                ::operator new(size + sizeof(Header) + blockAlignment, std::nothrow));
+            if (block == nullptr) {
+                return nullptr;
+            }
+            auto address = reinterpret_cast<std::uintptr_t>(block + sizeof(Header));
+            address = (address + blockAlignment - 1) & ~(blockAlignment - 1);
+            payload = reinterpret_cast<std::byte *>(address);
+        }
+
+        auto *header = reinterpret_cast<Header *>(payload - sizeof(Header));
+        header->Size = size;
+        header->Offset = static_cast<size_t>(payload - block);
+        header->Pool = poolIndex;
+        header->ObjectType = currentObjectType;
+        header->Scope = scope;
+
+        CountLocked(report.Scopes[scope], size);
+        CountLocked(report.ObjectTypes[currentObjectType], size);
+        return payload;
+    }
+
+    void HostAllocator::FreeLocked(void *memory) {
+        auto *payload = static_cast<std::byte *>(memory);
+        auto *header = reinterpret_cast<Header *>(payload - sizeof(Header));
+        UncountLocked(report.Scopes[header->Scope], header->Size);
+        UncountLocked(report.ObjectTypes[header->ObjectType], header->Size);
+
+        std::byte *block = payload - header->Offset;
+        if (header->Pool != NOT_POOLED) {
+            pools[header->Pool]->FreeSlots.push_back(block);
+        } else {
+            ::operator delete(block);
+        }
+    }
+
+    void HostAllocator::CountLocked(HostAllocationCounters &counters, size_t bytes) {
+        ++counters.Allocations;
+        counters.TotalBytes += bytes;
+        counters.LiveBytes += bytes;
+        counters.PeakBytes = std::max(counters.PeakBytes, counters.LiveBytes);
+    }
+
+    void HostAllocator::UncountLocked(HostAllocationCounters &counters, size_t bytes) {
+        ++counters.Frees;
+        counters.LiveBytes -= bytes;
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,119 @@
+#ifndef HOST_ALLOCATOR_H
+#define HOST_ALLOCATOR_H
+
+#include "core.h"
+
+#include <vulkan/vulkan.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace XIV::Render {
+    constexpr size_t HOST_ALLOCATION_SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+    struct HostAllocationCounters {
+        u64 Allocations = 0;
+        u64 Reallocations = 0;
+        u64 Frees = 0;
+        u64 TotalBytes = 0; // every byte ever handed out
+        u64 LiveBytes = 0;
+        u64 PeakBytes = 0;
+    };
+
+    struct HostAllocationReport {
+        HostAllocationCounters Scopes[HOST_ALLOCATION_SCOPE_COUNT]{};
+        // Keyed by the HostAllocator::ObjectScope active when the driver allocated.
+        std::map<VkObjectType, HostAllocationCounters> ObjectTypes{};
+        // Memory the driver allocated itself and only reported, such as executable code.
+        u64 InternalBytes = 0;
+        u64 PooledAllocations = 0;
+    };
+
+    // VkAllocationCallbacks that route the driver's host allocations through the engine, when
+    // built with XIV_TRACK_HOST_ALLOCATIONS. Short-lived command and object scope allocations
+    // come from per-scope size-class pools; the rest go to the heap. Every allocation is
+    // counted by scope and by the object type being created on the calling thread, so churn
+    // during swapchain recreation and pipeline builds shows up in the report.
+    //
+    // Without the option, Callbacks() is null and the driver uses its own allocator.
+    class HostAllocator {
+    public:
+#ifdef XIV_TRACK_HOST_ALLOCATIONS
+        static constexpr bool IS_ENABLED = true;
+#else
+        static constexpr bool IS_ENABLED = false;
+#endif
+
+        // Attributes this thread's allocations to objectType while alive. Wrap vkCreate* calls.
+        class ObjectScope {
+        public:
+            explicit ObjectScope(VkObjectType objectType) : previous{currentObjectType} {
+                currentObjectType = objectType;
+            }
+
+            ~ObjectScope() {
+                currentObjectType = previous;
+            }
+
+            ObjectScope(const ObjectScope &) = delete;
+            ObjectScope &operator=(const ObjectScope &) = delete;
+
+        private:
+            VkObjectType previous;
+        };
+
+        HostAllocator();
+        // Every object created with these callbacks must already be destroyed.
+        ~HostAllocator();
+        HostAllocator(const HostAllocator &) = delete;
+        HostAllocator &operator=(const HostAllocator &) = delete;
+
+        // Pass to every vkCreate* and the matching vkDestroy*. Null when tracking is off.
+        const VkAllocationCallbacks *Callbacks() const {
+            return IS_ENABLED ? &callbacks : nullptr;
+        }
+
+        HostAllocationReport GetReport() const;
+        void PrintReport(std::ostream &out) const;
+
+    private:
+        struct Header;
+        struct Pool;
+
+        static VKAPI_ATTR void *VKAPI_CALL
+        Allocation(void *userData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+        static VKAPI_ATTR void *VKAPI_CALL Reallocation(void *userData,
+                                                        void *original,
+                                                        size_t size,
+                                                        size_t alignment,
+                                                        VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL Free(void *userData, void *memory);
+        static VKAPI_ATTR void VKAPI_CALL InternalAllocation(void *userData,
+                                                             size_t size,
+                                                             VkInternalAllocationType type,
+                                                             VkSystemAllocationScope scope);
+        static VKAPI_ATTR void VKAPI_CALL InternalFree(void *userData,
+                                                       size_t size,
+                                                       VkInternalAllocationType type,
+                                                       VkSystemAllocationScope scope);
+
+        void *AllocateLocked(size_t size, size_t alignment, VkSystemAllocationScope scope);
+        void FreeLocked(void *memory);
+        static void CountLocked(HostAllocationCounters &counters, size_t bytes);
+        static void UncountLocked(HostAllocationCounters &counters, size_t bytes);
+
+        static thread_local VkObjectType currentObjectType;
+
+        VkAllocationCallbacks callbacks{};
+
+        mutable std::mutex mutex;
+        // Command and object scope, one pool per size class.
+        std::vector<std::unique_ptr<Pool>> pools;
+        HostAllocationReport report{};
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
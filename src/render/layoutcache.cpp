@@ -0,0 +1,146 @@
+#include "layoutcache.h"
+
+#include "device.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+
+namespace XIV::Render {
+    LayoutCache::LayoutCache(Device &device) : device{device} {}
+
+    LayoutCache::~LayoutCache() {
+        for (const auto &kv : pipelineLayouts) {
+            vkDestroyPipelineLayout(device.VulkanDevice, kv.second, device.HostCallbacks());
+        }
+        for (const auto &kv : setLayouts) {
+            vkDestroyDescriptorSetLayout(device.VulkanDevice, kv.second, device.HostCallbacks());
+        }
+    }
+
+    VkDescriptorSetLayout
+    LayoutCache::GetSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                              const std::vector<VkDescriptorBindingFlagsEXT> &bindingFlags,
+                              VkDescriptorSetLayoutCreateFlags flags) {
+        assert((bindingFlags.empty() || bindingFlags.size() == bindings.size()) &&
+               "Binding flags must match the bindings one to one");
+
+        // Sort the bindings and their flags together.
+        std::vector<u32> order(bindings.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&bindings](u32 a, u32 b) {
+            return bindings[a].binding < bindings[b].binding;
+        });
+
+        std::vector<VkDescriptorSetLayoutBinding> sortedBindings{};
+        std::vector<VkDescriptorBindingFlagsEXT> sortedFlags{};
+        bool hasBindingFlags = false;
+        for (u32 i : order) {
+            sortedBindings.push_back(bindings[i]);
+            sortedFlags.push_back(bindingFlags.empty() ? 0 : bindingFlags[i]);
+            hasBindingFlags = hasBindingFlags || sortedFlags.back() != 0;
+        }
+
+        Key key{};
+        key.reserve(1 + sortedBindings.size() * 3);
+        key.push_back(flags);
+        for (u32 i = 0; i < sortedBindings.size(); ++i) {
+            const VkDescriptorSetLayoutBinding &binding = sortedBindings[i];
+            assert(binding.pImmutableSamplers == nullptr && "Immutable samplers are not cached");
+            key.push_back(static_cast<u64>(binding.binding) << 32 | binding.descriptorType);
+            key.push_back(static_cast<u64>(binding.descriptorCount) << 32 | binding.stageFlags);
+            key.push_back(sortedFlags[i]);
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = setLayouts.find(key);
+        if (it != setLayouts.end()) {
+            return it->second;
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+        bindingFlagsInfo.sType =
+            VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        bindingFlagsInfo.bindingCount = static_cast<u32>(sortedFlags.size());
+        bindingFlagsInfo.pBindingFlags = sortedFlags.data();
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = hasBindingFlags ? &bindingFlagsInfo : nullptr;
+        layoutInfo.flags = flags;
+        layoutInfo.bindingCount = static_cast<u32>(sortedBindings.size());
+        layoutInfo.pBindings = sortedBindings.data();
+
+        VkDescriptorSetLayout layout;
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT};
+        if (vkCreateDescriptorSetLayout(
+                device.VulkanDevice, &layoutInfo, device.HostCallbacks(), &layout) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor set layout!");
+        }
+        setLayouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    VkPipelineLayout
+    LayoutCache::GetPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayoutHandles,
+                                   const std::vector<VkPushConstantRange> &pushRanges) {
+        // Set order matters; the order push constant ranges are listed in does not.
+        std::vector<VkPushConstantRange> ranges = pushRanges;
+        std::sort(ranges.begin(), ranges.end(), [](const auto &a, const auto &b) {
+            if (a.offset != b.offset) {
+                return a.offset < b.offset;
+            }
+            return a.stageFlags < b.stageFlags;
+        });
+
+        Key key{};
+        key.push_back(setLayoutHandles.size());
+        for (VkDescriptorSetLayout setLayout : setLayoutHandles) {
+            key.push_back(reinterpret_cast<u64>(setLayout));
+        }
+        for (const VkPushConstantRange &range : ranges) {
+            key.push_back(static_cast<u64>(range.stageFlags));
+            key.push_back(static_cast<u64>(range.offset) << 32 | range.size);
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = pipelineLayouts.find(key);
+        if (it != pipelineLayouts.end()) {
+            return it->second;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<u32>(setLayoutHandles.size());
+        pipelineLayoutInfo.pSetLayouts = setLayoutHandles.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<u32>(ranges.size());
+        pipelineLayoutInfo.pPushConstantRanges = ranges.data();
+
+        VkPipelineLayout layout;
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_PIPELINE_LAYOUT};
+        if (vkCreatePipelineLayout(
+                device.VulkanDevice, &pipelineLayoutInfo, device.HostCallbacks(), &layout) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        pipelineLayouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    size_t LayoutCache::SetLayoutCount() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return setLayouts.size();
+    }
+
+    size_t LayoutCache::PipelineLayoutCount() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return pipelineLayouts.size();
+    }
+
+    size_t LayoutCache::KeyHash::operator()(const Key &key) const {
+        return static_cast<size_t>(HashBytes(key.data(), key.size() * sizeof(u64)));
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef LAYOUT_CACHE_H
+#define LAYOUT_CACHE_H
+
+#include "core.h"
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace XIV::Render {
+    class Device;
+
+    // Hands out one descriptor set layout per distinct set of bindings, and one pipeline layout
+    // per distinct list of set layouts and push constant ranges. Keys are canonical (bindings
+    // are sorted), so builders that list the same bindings in any order share a handle, and
+    // layouts from different systems are compatible by construction. The cache owns every
+    // handle; they live as long as the device.
+    class LayoutCache {
+    public:
+        // Push constant range shared by the render systems. Pipeline layouts only stay
+        // compatible, and keep their bound sets across pipeline switches, when their push
+        // constant ranges match too. Systems with the same sets therefore get one and the same
+        // cached layout. 128 bytes is the minimum every device supports.
+        static constexpr u32 SHARED_PUSH_CONSTANT_SIZE = 128;
+        static VkPushConstantRange SharedPushConstantRange() {
+            return {VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    0,
+                    SHARED_PUSH_CONSTANT_SIZE};
+        }
+
+        explicit LayoutCache(Device &device);
+        ~LayoutCache();
+        LayoutCache(const LayoutCache &) = delete;
+        LayoutCache &operator=(const LayoutCache &) = delete;
+
+        // bindingFlags is empty or holds one entry per binding, e.g. for partially bound,
+        // update-after-bind arrays. Immutable samplers are not supported.
+        VkDescriptorSetLayout
+        GetSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                     const std::vector<VkDescriptorBindingFlagsEXT> &bindingFlags = {},
+                     VkDescriptorSetLayoutCreateFlags flags = 0);
+        VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+                                           const std::vector<VkPushConstantRange> &pushRanges);
+
+        size_t SetLayoutCount() const;
+        size_t PipelineLayoutCount() const;
+
+    private:
+        // The create info flattened into words, so equal layouts compare and hash equal.
+        using Key = std::vector<u64>;
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+
+        Device &device;
+
+        mutable std::mutex mutex;
+        std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> setLayouts;
+        std::unordered_map<Key, VkPipelineLayout, KeyHash> pipelineLayouts;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
@@ -0,0 +1,605 @@
+#include "memoryallocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace XIV::Render {
+    namespace {
+        // Each power-of-two size class is split into 2^SL_LOG2 linear sub-classes.
+        constexpr u32 SL_LOG2 = 4;
+        constexpr u32 SL_COUNT = 1u << SL_LOG2;
+        constexpr u32 FL_COUNT = 64 - SL_LOG2 + 1;
+        // Leftovers smaller than this stay attached to the allocation instead of becoming a
+        // free node of their own.
+        constexpr VkDeviceSize MIN_SPLIT_SIZE = 256;
+        constexpr u32 NONE = std::numeric_limits<u32>::max();
+        // Share of a heap assumed to be ours when the driver cannot report a budget.
+        constexpr VkDeviceSize FALLBACK_BUDGET_PERCENT = 80;
+
+        u32 Log2(u64 value) {
+            u32 log = 0;
+            while (value >>= 1) {
+                ++log;
+            }
+            return log;
+        }
+
+        u32 LowestBit(u64 value) {
+            u32 bit = 0;
+            while ((value & 1) == 0) {
+                value >>= 1;
+                ++bit;
+            }
+            return bit;
+        }
+
+        VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // Sizes below SL_COUNT map linearly into the first level.
+        void Mapping(VkDeviceSize size, u32 &fl, u32 &sl) {
+            if (size < SL_COUNT) {
+                fl = 0;
+                sl = static_cast<u32>(size);
+                return;
+            }
+            u32 log = Log2(size);
+            fl = log - SL_LOG2 + 1;
+            sl = static_cast<u32>(size >> (log - SL_LOG2)) - SL_COUNT;
+        }
+    } // namespace
+
+    const char *MemoryCategoryName(MemoryCategory category) {
+        switch (category) {
+        case MemoryCategory::Geometry:
+            return "geometry";
+        case MemoryCategory::Uniforms:
+            return "uniforms";
+        case MemoryCategory::Depth:
+            return "depth";
+        case MemoryCategory::Textures:
+            return "textures";
+        case MemoryCategory::Staging:
+            return "staging";
+        default:
+            return "other";
+        }
+    }
+
+    float MemoryBudget::DeviceLocalPressure() const {
+        float pressure = 0.0f;
+        for (const Heap &heap : Heaps) {
+            if (heap.IsDeviceLocal && heap.Budget > 0) {
+                pressure = std::max(pressure,
+                                    static_cast<float>(heap.Usage) /
+                                        static_cast<float>(heap.Budget));
+            }
+        }
+        return pressure;
+    }
+
+    VkDeviceSize MemoryBudget::CategoryBytes(MemoryCategory category) const {
+        VkDeviceSize bytes = 0;
+        for (const Heap &heap : Heaps) {
+            bytes += heap.CategoryBytes[static_cast<size_t>(category)];
+        }
+        return bytes;
+    }
+
+    // One vkAllocateMemory and the TLSF heap that carves it up. Nodes cover the whole block in
+    // physical order; free ones are also linked into the list for their size class.
+    struct MemoryAllocator::Block {
+        struct Node {
+            VkDeviceSize Offset = 0;
+            VkDeviceSize Size = 0;
+            u32 PreviousPhysical = NONE;
+            u32 NextPhysical = NONE;
+            u32 PreviousFree = NONE;
+            u32 NextFree = NONE;
+            bool IsFree = true;
+        };
+
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        void *Mapped = nullptr;
+        u32 MemoryType = 0;
+        VkDeviceSize Size = 0;
+        VkDeviceSize UsedBytes = 0;
+        u32 AllocationCount = 0;
+
+        std::vector<Node> Nodes{};
+        std::vector<u32> SpareNodes{};
+        u64 FirstLevelMap = 0;
+        u32 SecondLevelMaps[FL_COUNT]{};
+        u32 FreeHeads[FL_COUNT][SL_COUNT];
+
+        Block(VkDeviceMemory memory, void *mapped, u32 memoryType, VkDeviceSize size)
+            : Memory{memory}, Mapped{mapped}, MemoryType{memoryType}, Size{size} {
+            std::fill(&FreeHeads[0][0], &FreeHeads[0][0] + FL_COUNT * SL_COUNT, NONE);
+            u32 node = NewNode();
+            Nodes[node].Size = size;
+            InsertFree(node);
+        }
+
+        u32 NewNode() {
+            if (!SpareNodes.empty()) {
+                u32 node = SpareNodes.back();
+                SpareNodes.pop_back();
+                Nodes[node] = Node{};
+                return node;
+            }
+            Nodes.emplace_back();
+            return static_cast<u32>(Nodes.size() - 1);
+        }
+
+        void InsertFree(u32 node) {
+            u32 fl, sl;
+            Mapping(Nodes[node].Size, fl, sl);
+            Nodes[node].IsFree = true;
+            Nodes[node].PreviousFree = NONE;
+            Nodes[node].NextFree = FreeHeads[fl][sl];
+            if (FreeHeads[fl][sl] != NONE) {
+                Nodes[FreeHeads[fl][sl]].PreviousFree = node;
+            }
+            FreeHeads[fl][sl] = node;
+            FirstLevelMap |= 1ull << fl;
+            SecondLevelMaps[fl] |= 1u << sl;
+        }
+
+        void RemoveFree(u32 node) {
+            u32 fl, sl;
+            Mapping(Nodes[node].Size, fl, sl);
+            u32 previous = Nodes[node].PreviousFree;
+            u32 next = Nodes[node].NextFree;
+            if (previous != NONE) {
+                Nodes[previous].NextFree = next;
+            } else {
+                FreeHeads[fl][sl] = next;
+            }
+            if (next != NONE) {
+                Nodes[next].PreviousFree = previous;
+            }
+
+            if (FreeHeads[fl][sl] == NONE) {
+                SecondLevelMaps[fl] &= ~(1u << sl);
+                if (SecondLevelMaps[fl] == 0) {
+                    FirstLevelMap &= ~(1ull << fl);
+                }
+            }
+        }
+
+        // Splits a new physical node off the front of node, size bytes long.
+        u32 SplitFront(u32 node, VkDeviceSize size) {
+            u32 front = NewNode();
+            Nodes[front].Offset = Nodes[node].Offset;
+            Nodes[front].Size = size;
+            Nodes[front].PreviousPhysical = Nodes[node].PreviousPhysical;
+            Nodes[front].NextPhysical = node;
+            if (Nodes[front].PreviousPhysical != NONE) {
+                Nodes[Nodes[front].PreviousPhysical].NextPhysical = front;
+            }
+            Nodes[node].PreviousPhysical = front;
+            Nodes[node].Offset += size;
+            Nodes[node].Size -= size;
+            return front;
+        }
+
+        // Absorbs node's next physical neighbor into it.
+        void MergeNext(u32 node) {
+            u32 next = Nodes[node].NextPhysical;
+            Nodes[node].Size += Nodes[next].Size;
+            Nodes[node].NextPhysical = Nodes[next].NextPhysical;
+            if (Nodes[node].NextPhysical != NONE) {
+                Nodes[Nodes[node].NextPhysical].PreviousPhysical = node;
+            }
+            SpareNodes.push_back(next);
+        }
+
+        bool Allocate(VkDeviceSize size, VkDeviceSize alignment, u32 &result) {
+            // Round the request up to the next size class, so that any node in the class found
+            // fits without walking its list.
+            VkDeviceSize searchSize = size + alignment - 1;
+            if (searchSize >= SL_COUNT) {
+                searchSize += (1ull << (Log2(searchSize) - SL_LOG2)) - 1;
+            }
+            u32 fl, sl;
+            Mapping(searchSize, fl, sl);
+            if (fl >= FL_COUNT) {
+                return false;
+            }
+
+            u32 slMap = SecondLevelMaps[fl] & (~0u << sl);
+            if (slMap == 0) {
+                u64 flMap = fl + 1 < 64 ? FirstLevelMap & (~0ull << (fl + 1)) : 0;
+                if (flMap == 0) {
+                    return false;
+                }
+                fl = LowestBit(flMap);
+                slMap = SecondLevelMaps[fl];
+            }
+            sl = LowestBit(slMap);
+
+            u32 node = FreeHeads[fl][sl];
+            RemoveFree(node);
+
+            // Alignment padding goes back to the free lists. Free nodes never touch, so the
+            // node before this one is in use and nothing needs merging.
+            VkDeviceSize padding = AlignUp(Nodes[node].Offset, alignment) - Nodes[node].Offset;
+            if (padding > 0) {
+                InsertFree(SplitFront(node, padding));
+            }
+
+            if (Nodes[node].Size - size >= MIN_SPLIT_SIZE) {
+                u32 used = SplitFront(node, size);
+                InsertFree(node);
+                node = used;
+            }
+
+            Nodes[node].IsFree = false;
+            UsedBytes += Nodes[node].Size;
+            ++AllocationCount;
+            result = node;
+            return true;
+        }
+
+        void Free(u32 node) {
+            UsedBytes -= Nodes[node].Size;
+            --AllocationCount;
+
+            u32 previous = Nodes[node].PreviousPhysical;
+            if (previous != NONE && Nodes[previous].IsFree) {
+                RemoveFree(previous);
+                MergeNext(previous);
+                node = previous;
+            }
+            u32 next = Nodes[node].NextPhysical;
+            if (next != NONE && Nodes[next].IsFree) {
+                RemoveFree(next);
+                MergeNext(node);
+            }
+            InsertFree(node);
+        }
+    };
+
+    MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice,
+                                     VkDevice device,
+                                     const VkAllocationCallbacks *hostCallbacks)
+        : device{device}, hostCallbacks{hostCallbacks} {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        const VkPhysicalDeviceLimits &limits = properties.limits;
+        bufferImageGranularity = std::max<VkDeviceSize>(limits.bufferImageGranularity, 1);
+        nonCoherentAtomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+        policy = MemoryPolicy{memoryProperties, properties.deviceType};
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        for (auto &block : blocks) {
+            if (block != nullptr) {
+                vkFreeMemory(device, block->Memory, hostCallbacks);
+            }
+        }
+    }
+
+    MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements &requirements,
+                                               VkMemoryPropertyFlags properties,
+                                               bool isLinear,
+                                               MemoryCategory category) {
+        return AllocateFromType(requirements,
+                                FindMemoryType(requirements.memoryTypeBits, properties),
+                                isLinear,
+                                category);
+    }
+
+    MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements &requirements,
+                                               MemoryUsage usage,
+                                               bool isLinear,
+                                               MemoryCategory category) {
+        std::vector<VkMemoryPropertyFlags> candidates = policy.Candidates(usage, requirements.size);
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            u32 memoryType = TryFindMemoryType(requirements.memoryTypeBits, candidates[i]);
+            if (memoryType == NONE_TYPE) {
+                continue;
+            }
+            if (i + 1 == candidates.size()) {
+                return AllocateFromType(requirements, memoryType, isLinear, category);
+            }
+            try {
+                return AllocateFromType(requirements, memoryType, isLinear, category);
+            } catch (const std::runtime_error &) {
+                // The preferred heap is full; try the next candidate.
+            }
+        }
+        throw std::runtime_error("Failed to find suitable memory type.");
+    }
+
+    MemoryAllocation MemoryAllocator::AllocateFromType(const VkMemoryRequirements &requirements,
+                                                       u32 memoryType,
+                                                       bool isLinear,
+                                                       MemoryCategory category) {
+        MemoryAllocation allocation = Suballocate(requirements, memoryType, isLinear);
+        allocation.Category = category;
+
+        std::lock_guard<std::mutex> lock{mutex};
+        categoryBytes[HeapIndex(memoryType)][static_cast<size_t>(category)] += allocation.Size;
+        return allocation;
+    }
+
+    MemoryAllocation MemoryAllocator::Suballocate(const VkMemoryRequirements &requirements,
+                                                  u32 memoryType,
+                                                  bool isLinear) {
+        VkDeviceSize size = requirements.size;
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+        // Giving optimal images whole granularity pages keeps them off any page a buffer uses.
+        if (!isLinear && bufferImageGranularity > 1) {
+            alignment = std::max(alignment, bufferImageGranularity);
+            size = AlignUp(size, bufferImageGranularity);
+        }
+        // Likewise, flushes of one allocation must never cover part of another.
+        if (IsHostVisible(memoryType) && !IsCoherent(memoryType)) {
+            alignment = std::max(alignment, nonCoherentAtomSize);
+            size = AlignUp(size, nonCoherentAtomSize);
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+
+        VkDeviceSize blockSize = BlockSize(memoryType);
+        if (size > blockSize / 2) {
+            return AllocateDedicated(memoryType, size);
+        }
+
+        auto suballocate = [&](u32 blockIndex) {
+            Block &block = *blocks[blockIndex];
+            MemoryAllocation allocation{};
+            if (!block.Allocate(size, alignment, allocation.Node)) {
+                return allocation;
+            }
+            allocation.Memory = block.Memory;
+            allocation.Offset = block.Nodes[allocation.Node].Offset;
+            allocation.Size = size;
+            allocation.MemoryType = memoryType;
+            allocation.Block = blockIndex;
+            if (block.Mapped != nullptr) {
+                allocation.Mapped = static_cast<u8 *>(block.Mapped) + allocation.Offset;
+            }
+            return allocation;
+        };
+
+        u32 emptySlot = static_cast<u32>(blocks.size());
+        for (u32 i = 0; i < blocks.size(); ++i) {
+            if (blocks[i] == nullptr) {
+                emptySlot = std::min(emptySlot, i);
+                continue;
+            }
+            if (blocks[i]->MemoryType != memoryType) {
+                continue;
+            }
+            MemoryAllocation allocation = suballocate(i);
+            if (allocation.Memory != VK_NULL_HANDLE) {
+                return allocation;
+            }
+        }
+
+        void *mapped = nullptr;
+        VkDeviceMemory memory = AllocateMemory(memoryType, blockSize, mapped);
+        if (memory == VK_NULL_HANDLE) {
+            // Not enough room left for a whole block; the resource may still fit on its own.
+            return AllocateDedicated(memoryType, size);
+        }
+
+        if (emptySlot == blocks.size()) {
+            blocks.emplace_back();
+        }
+        blocks[emptySlot] = std::make_unique<Block>(memory, mapped, memoryType, blockSize);
+        return suballocate(emptySlot);
+    }
+
+    void MemoryAllocator::Free(MemoryAllocation &allocation) {
+        if (allocation.Memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex};
+        categoryBytes[HeapIndex(allocation.MemoryType)][static_cast<size_t>(allocation.Category)] -=
+            allocation.Size;
+
+        if (allocation.Block == MemoryAllocation::DEDICATED) {
+            FreeMemory(allocation.Memory, allocation.MemoryType, allocation.Size);
+            --dedicatedCount;
+            dedicatedBytes -= allocation.Size;
+            allocation = {};
+            return;
+        }
+
+        Block &block = *blocks[allocation.Block];
+        block.Free(allocation.Node);
+
+        // Keep one block per memory type around so a load/unload cycle does not thrash
+        // vkAllocateMemory; any other block is released once it empties.
+        if (block.AllocationCount == 0) {
+            bool hasOtherBlock = std::any_of(blocks.begin(), blocks.end(), [&](const auto &other) {
+                return other != nullptr && other.get() != &block &&
+                       other->MemoryType == block.MemoryType;
+            });
+            if (hasOtherBlock) {
+                FreeMemory(block.Memory, block.MemoryType, block.Size);
+                blocks[allocation.Block].reset();
+            }
+        }
+        allocation = {};
+    }
+
+    VkResult MemoryAllocator::Flush(const MemoryAllocation &allocation,
+                                    VkDeviceSize size,
+                                    VkDeviceSize offset) {
+        if (IsCoherent(allocation.MemoryType)) {
+            return VK_SUCCESS;
+        }
+        VkMappedMemoryRange range = MappedRange(allocation, size, offset);
+        return vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    VkResult MemoryAllocator::Invalidate(const MemoryAllocation &allocation,
+                                         VkDeviceSize size,
+                                         VkDeviceSize offset) {
+        if (IsCoherent(allocation.MemoryType)) {
+            return VK_SUCCESS;
+        }
+        VkMappedMemoryRange range = MappedRange(allocation, size, offset);
+        return vkInvalidateMappedMemoryRanges(device, 1, &range);
+    }
+
+    MemoryAllocator::Stats MemoryAllocator::GetStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        Stats stats{};
+        stats.DedicatedCount = dedicatedCount;
+        stats.DedicatedBytes = dedicatedBytes;
+        stats.AllocationCount = dedicatedCount;
+        for (const auto &block : blocks) {
+            if (block != nullptr) {
+                ++stats.BlockCount;
+                stats.BlockBytes += block->Size;
+                stats.UsedBytes += block->UsedBytes;
+                stats.AllocationCount += block->AllocationCount;
+            }
+        }
+        return stats;
+    }
+
+    MemoryBudget MemoryAllocator::GetBudget(const VkDeviceSize *heapBudget,
+                                            const VkDeviceSize *heapUsage) const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        MemoryBudget budget{};
+        budget.IsFromExtension = heapBudget != nullptr && heapUsage != nullptr;
+        budget.Heaps.resize(memoryProperties.memoryHeapCount);
+        for (u32 i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+            MemoryBudget::Heap &heap = budget.Heaps[i];
+            heap.Size = memoryProperties.memoryHeaps[i].size;
+            heap.IsDeviceLocal =
+                (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+            heap.AllocatedBytes = heapBytes[i];
+            std::copy(std::begin(categoryBytes[i]),
+                      std::end(categoryBytes[i]),
+                      std::begin(heap.CategoryBytes));
+            if (budget.IsFromExtension) {
+                heap.Budget = heapBudget[i];
+                heap.Usage = heapUsage[i];
+            } else {
+                heap.Budget = heap.Size / 100 * FALLBACK_BUDGET_PERCENT;
+                heap.Usage = heapBytes[i];
+            }
+        }
+        return budget;
+    }
+
+    u32 MemoryAllocator::TryFindMemoryType(u32 typeFilter,
+                                           VkMemoryPropertyFlags properties) const {
+        // Prefer types that are not host-visible unless that was asked for, so device-local
+        // requests stay out of the BAR on drivers that list the mappable type first.
+        bool wantsHostVisible = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+        u32 fallback = NONE_TYPE;
+        for (u32 i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+            if ((typeFilter & (1 << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                if (wantsHostVisible || !IsHostVisible(i)) {
+                    return i;
+                }
+                if (fallback == NONE_TYPE) {
+                    fallback = i;
+                }
+            }
+        }
+        return fallback;
+    }
+
+    u32 MemoryAllocator::FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties) const {
+        u32 memoryType = TryFindMemoryType(typeFilter, properties);
+        if (memoryType == NONE_TYPE) {
+            throw std::runtime_error("Failed to find suitable memory type.");
+        }
+        return memoryType;
+    }
+
+    VkDeviceSize MemoryAllocator::BlockSize(u32 memoryType) const {
+        u32 heap = memoryProperties.memoryTypes[memoryType].heapIndex;
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[heap].size;
+        return heapSize <= SMALL_HEAP_SIZE ? heapSize / 8 : DEFAULT_BLOCK_SIZE;
+    }
+
+    bool MemoryAllocator::IsCoherent(u32 memoryType) const {
+        return (memoryProperties.memoryTypes[memoryType].propertyFlags &
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    }
+
+    bool MemoryAllocator::IsHostVisible(u32 memoryType) const {
+        return (memoryProperties.memoryTypes[memoryType].propertyFlags &
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    }
+
+    VkDeviceMemory
+    MemoryAllocator::AllocateMemory(u32 memoryType, VkDeviceSize size, void *&mapped) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_DEVICE_MEMORY};
+        if (vkAllocateMemory(device, &allocInfo, hostCallbacks, &memory) != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
+        }
+
+        // Memory can only be mapped once, so host-visible memory is mapped here for good.
+        mapped = nullptr;
+        if (IsHostVisible(memoryType) &&
+            vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            vkFreeMemory(device, memory, hostCallbacks);
+            return VK_NULL_HANDLE;
+        }
+        heapBytes[HeapIndex(memoryType)] += size;
+        return memory;
+    }
+
+    void MemoryAllocator::FreeMemory(VkDeviceMemory memory, u32 memoryType, VkDeviceSize size) {
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_DEVICE_MEMORY};
+        vkFreeMemory(device, memory, hostCallbacks);
+        heapBytes[HeapIndex(memoryType)] -= size;
+    }
+
+    MemoryAllocation MemoryAllocator::AllocateDedicated(u32 memoryType, VkDeviceSize size) {
+        MemoryAllocation allocation{};
+        allocation.Memory = AllocateMemory(memoryType, size, allocation.Mapped);
+        if (allocation.Memory == VK_NULL_HANDLE) {
+            throw std::runtime_error("Failed to allocate device memory.");
+        }
+        allocation.Size = size;
+        allocation.MemoryType = memoryType;
+
+        ++dedicatedCount;
+        dedicatedBytes += size;
+        return allocation;
+    }
+
+    VkMappedMemoryRange MemoryAllocator::MappedRange(const MemoryAllocation &allocation,
+                                                     VkDeviceSize size,
+                                                     VkDeviceSize offset) {
+        VkDeviceSize end = allocation.Offset + allocation.Size;
+        VkDeviceSize begin = allocation.Offset + offset;
+        VkDeviceSize rangeEnd = size == VK_WHOLE_SIZE ? end : begin + size;
+        begin = begin / nonCoherentAtomSize * nonCoherentAtomSize;
+        rangeEnd = std::min(AlignUp(rangeEnd, nonCoherentAtomSize), end);
+
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.Memory;
+        range.offset = begin;
+        range.size = rangeEnd - begin;
+        return range;
+    }
+} // namespace XIV::Render
\ No newline at end of file
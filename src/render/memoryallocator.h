@@ -0,0 +1,174 @@
+#ifndef MEMORY_ALLOCATOR_H
+#define MEMORY_ALLOCATOR_H
+
+#include "core.h"
+#include "hostallocator.h"
+#include "memorypolicy.h"
+
+#include <vulkan/vulkan.h>
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace XIV::Render {
+    // What an allocation holds, for budget reports.
+    enum class MemoryCategory : u8 {
+        Other,
+        Geometry,
+        Uniforms,
+        Depth,
+        Textures,
+        Staging,
+        Count,
+    };
+
+    constexpr size_t MEMORY_CATEGORY_COUNT = static_cast<size_t>(MemoryCategory::Count);
+
+    const char *MemoryCategoryName(MemoryCategory category);
+
+    // A range of device memory handed out by the MemoryAllocator. Host-visible memory stays
+    // mapped for as long as it is allocated, so Mapped is valid whenever it is non-null.
+    struct MemoryAllocation {
+        static constexpr u32 DEDICATED = std::numeric_limits<u32>::max();
+
+        VkDeviceMemory Memory = VK_NULL_HANDLE;
+        VkDeviceSize Offset = 0;
+        VkDeviceSize Size = 0;
+        void *Mapped = nullptr;
+        u32 MemoryType = 0;
+        u32 Block = DEDICATED;
+        u32 Node = 0;
+        MemoryCategory Category = MemoryCategory::Other;
+    };
+
+    // Heap usage against budget at one point in time. Budget and Usage come from
+    // VK_EXT_memory_budget when the device has it; they cover every process on the GPU and
+    // already include this one. Without it, Budget is a conservative share of the heap and
+    // Usage is what this allocator holds.
+    struct MemoryBudget {
+        struct Heap {
+            VkDeviceSize Size = 0;
+            VkDeviceSize Budget = 0;
+            VkDeviceSize Usage = 0;
+            VkDeviceSize AllocatedBytes = 0; // device memory held by the allocator
+            VkDeviceSize CategoryBytes[MEMORY_CATEGORY_COUNT]{};
+            bool IsDeviceLocal = false;
+        };
+
+        std::vector<Heap> Heaps;
+        bool IsFromExtension = false;
+
+        // Usage over budget of the fullest device-local heap. Past 1.0 the driver starts
+        // paging or failing allocations.
+        float DeviceLocalPressure() const;
+        VkDeviceSize CategoryBytes(MemoryCategory category) const;
+    };
+
+    // Suballocates buffers and images out of large per-memory-type blocks, so the number of
+    // vkAllocateMemory calls stays flat as the scene grows. Each block is a two-level segregated
+    // fit (TLSF) heap: allocation and free are constant time and free neighbors merge right away.
+    // Resources of at least half a block get a dedicated allocation instead.
+    class MemoryAllocator {
+    public:
+        static constexpr u32 NONE_TYPE = std::numeric_limits<u32>::max();
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+        // Heaps at or below this size (integrated GPUs, the small BAR heap) use an eighth of
+        // the heap per block instead.
+        static constexpr VkDeviceSize SMALL_HEAP_SIZE = 1024ull * 1024 * 1024;
+
+        struct Stats {
+            u32 BlockCount = 0;
+            u32 DedicatedCount = 0;
+            u32 AllocationCount = 0;
+            VkDeviceSize BlockBytes = 0;
+            VkDeviceSize DedicatedBytes = 0;
+            VkDeviceSize UsedBytes = 0; // suballocated bytes, alignment padding included
+        };
+
+        // hostCallbacks are passed to vkAllocateMemory and vkFreeMemory.
+        MemoryAllocator(VkPhysicalDevice physicalDevice,
+                        VkDevice device,
+                        const VkAllocationCallbacks *hostCallbacks = nullptr);
+        ~MemoryAllocator();
+        MemoryAllocator(const MemoryAllocator &) = delete;
+        MemoryAllocator &operator=(const MemoryAllocator &) = delete;
+
+        // isLinear is false for optimally tiled images, which must not share a
+        // bufferImageGranularity page with buffers.
+        MemoryAllocation Allocate(const VkMemoryRequirements &requirements,
+                                  VkMemoryPropertyFlags properties,
+                                  bool isLinear = true,
+                                  MemoryCategory category = MemoryCategory::Other);
+        // Lets the policy choose the memory, falling back through its candidates when the
+        // preferred heap is missing or out of space.
+        MemoryAllocation Allocate(const VkMemoryRequirements &requirements,
+                                  MemoryUsage usage,
+                                  bool isLinear = true,
+                                  MemoryCategory category = MemoryCategory::Other);
+        void Free(MemoryAllocation &allocation);
+
+        // Flush and invalidate a range relative to the allocation, widened to the device's
+        // nonCoherentAtomSize. No-ops for coherent memory.
+        VkResult Flush(const MemoryAllocation &allocation,
+                       VkDeviceSize size = VK_WHOLE_SIZE,
+                       VkDeviceSize offset = 0);
+        VkResult Invalidate(const MemoryAllocation &allocation,
+                            VkDeviceSize size = VK_WHOLE_SIZE,
+                            VkDeviceSize offset = 0);
+
+        Stats GetStats() const;
+        // heapBudget and heapUsage are the VK_EXT_memory_budget values, or null without it.
+        MemoryBudget GetBudget(const VkDeviceSize *heapBudget = nullptr,
+                               const VkDeviceSize *heapUsage = nullptr) const;
+
+        const MemoryPolicy &GetPolicy() const {
+            return policy;
+        }
+
+        VkMemoryPropertyFlags PropertyFlags(const MemoryAllocation &allocation) const {
+            return memoryProperties.memoryTypes[allocation.MemoryType].propertyFlags;
+        }
+
+    private:
+        struct Block;
+
+        MemoryAllocation AllocateFromType(const VkMemoryRequirements &requirements,
+                                          u32 memoryType,
+                                          bool isLinear,
+                                          MemoryCategory category);
+        MemoryAllocation
+        Suballocate(const VkMemoryRequirements &requirements, u32 memoryType, bool isLinear);
+        // Returns NONE_TYPE when no type matches.
+        u32 TryFindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties) const;
+        u32 FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties) const;
+        VkDeviceSize BlockSize(u32 memoryType) const;
+        bool IsCoherent(u32 memoryType) const;
+        bool IsHostVisible(u32 memoryType) const;
+        u32 HeapIndex(u32 memoryType) const {
+            return memoryProperties.memoryTypes[memoryType].heapIndex;
+        }
+        VkDeviceMemory AllocateMemory(u32 memoryType, VkDeviceSize size, void *&mapped);
+        void FreeMemory(VkDeviceMemory memory, u32 memoryType, VkDeviceSize size);
+        MemoryAllocation AllocateDedicated(u32 memoryType, VkDeviceSize size);
+        VkMappedMemoryRange
+        MappedRange(const MemoryAllocation &allocation, VkDeviceSize size, VkDeviceSize offset);
+
+        VkDevice device;
+        const VkAllocationCallbacks *hostCallbacks;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        VkDeviceSize bufferImageGranularity = 1;
+        VkDeviceSize nonCoherentAtomSize = 1;
+        MemoryPolicy policy;
+
+        mutable std::mutex mutex;
+        std::vector<std::unique_ptr<Block>> blocks; // null slots are reused
+        u32 dedicatedCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+        VkDeviceSize heapBytes[VK_MAX_MEMORY_HEAPS]{};
+        VkDeviceSize categoryBytes[VK_MAX_MEMORY_HEAPS][MEMORY_CATEGORY_COUNT]{};
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
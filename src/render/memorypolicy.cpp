@@ -0,0 +1,64 @@
+#include "memorypolicy.h"
+
+namespace XIV::Render {
+    namespace {
+        constexpr VkMemoryPropertyFlags DEVICE_MAPPED = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        constexpr VkMemoryPropertyFlags HOST_MAPPED =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        // Without resizable BAR, keep single resources to a sixteenth of the window so a few
+        // frame buffers cannot crowd the driver out of it.
+        constexpr VkDeviceSize SMALL_BAR_RESOURCE_DIVISOR = 16;
+    } // namespace
+
+    MemoryPolicy::MemoryPolicy(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                               VkPhysicalDeviceType deviceType) {
+        VkDeviceSize largestMappedHeap = 0;
+        for (u32 i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+            const VkMemoryType &type = memoryProperties.memoryTypes[i];
+            const VkMemoryHeap &heap = memoryProperties.memoryHeaps[type.heapIndex];
+            if ((type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) == 0) {
+                continue;
+            }
+            if ((type.propertyFlags & DEVICE_MAPPED) == DEVICE_MAPPED &&
+                heap.size > largestMappedHeap) {
+                largestMappedHeap = heap.size;
+            }
+        }
+
+        bool hasHostHeap = false;
+        for (u32 i = 0; i < memoryProperties.memoryHeapCount; ++i) {
+            if ((memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) == 0) {
+                hasHostHeap = true;
+            }
+        }
+
+        barHeapSize = largestMappedHeap;
+        // A mappable VRAM heap alone is not enough: discrete GPUs with resizable BAR have one
+        // too. Unified memory is an integrated GPU, or a device with no system memory heap.
+        isUnifiedMemory = largestMappedHeap > 0 &&
+                          (deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || !hasHostHeap);
+    }
+
+    std::vector<VkMemoryPropertyFlags> MemoryPolicy::Candidates(MemoryUsage usage,
+                                                                VkDeviceSize size) const {
+        switch (usage) {
+        case MemoryUsage::GpuOnly:
+            if (isUnifiedMemory) {
+                return {DEVICE_MAPPED, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+            }
+            return {VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+        case MemoryUsage::Dynamic:
+            if (barHeapSize > 0 && (isUnifiedMemory || HasResizableBar() ||
+                                    size <= barHeapSize / SMALL_BAR_RESOURCE_DIVISOR)) {
+                return {DEVICE_MAPPED, HOST_MAPPED};
+            }
+            return {HOST_MAPPED};
+        case MemoryUsage::Staging:
+        default:
+            // Every device has a host-visible coherent type, so mapped memory never needs flushes.
+            return {HOST_MAPPED};
+        }
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef MEMORY_POLICY_H
+#define MEMORY_POLICY_H
+
+#include "core.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+namespace XIV::Render {
+    // What a resource is for, rather than which memory flags it needs.
+    enum class MemoryUsage {
+        GpuOnly, // filled once through an upload, then only read by the GPU
+        Dynamic, // rewritten by the CPU every frame and read by the GPU
+        Staging, // CPU-written copy sources
+    };
+
+    // Picks memory property flags per usage from the device's heap layout. Integrated GPUs
+    // (unified memory) get host-visible device memory for everything, so uploads can skip the
+    // staging copy. Discrete GPUs with resizable BAR get dynamic data written straight into
+    // VRAM, but keep GpuOnly data in plain device-local memory so it goes through the transfer
+    // queue; without resizable BAR, only small dynamic buffers go into the legacy 256MB window.
+    class MemoryPolicy {
+    public:
+        // Host-visible device-local heaps at or below this are the legacy BAR window.
+        static constexpr VkDeviceSize SMALL_BAR_SIZE = 256ull * 1024 * 1024;
+
+        MemoryPolicy() = default;
+        MemoryPolicy(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                     VkPhysicalDeviceType deviceType);
+
+        // Flags to try in order. Later entries are fallbacks for when the preferred memory
+        // is missing or full; the last one is what the usage strictly needs.
+        std::vector<VkMemoryPropertyFlags> Candidates(MemoryUsage usage, VkDeviceSize size) const;
+
+        bool IsUnifiedMemory() const {
+            return isUnifiedMemory;
+        }
+
+        bool HasResizableBar() const {
+            return !isUnifiedMemory && barHeapSize > SMALL_BAR_SIZE;
+        }
+
+    private:
+        bool isUnifiedMemory = false;
+        VkDeviceSize barHeapSize = 0; // largest device-local heap with a host-visible type
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
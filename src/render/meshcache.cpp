@@ -0,0 +1,181 @@
+#include "meshcache.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace XIV::Render {
+    namespace {
+        // Each set of load options gets its own file, so loading one source two ways does not
+        // keep replacing the other's cache.
+        std::string MakeCachePath(const std::string &sourcePath, u64 optionsKey) {
+            char key[24];
+            snprintf(key, sizeof(key), ".%016llx", static_cast<unsigned long long>(optionsKey));
+            return sourcePath + key + MeshCache::EXTENSION;
+        }
+    } // namespace
+
+    MeshCache::MeshCache(const std::string &sourcePath, u64 optionsKey)
+        : sourcePath{sourcePath},
+          cachePath{MakeCachePath(sourcePath, optionsKey)},
+          optionsKey{optionsKey} {}
+
+    bool MeshCache::Load() {
+        hasSource = HashSource();
+
+        if (!cacheFile.Open(cachePath) || cacheFile.Size() < sizeof(Header)) {
+            cacheFile.Close();
+            return false;
+        }
+
+        Header header;
+        memcpy(&header, cacheFile.Data(), sizeof(Header));
+
+        Model::MeshView mesh{};
+        mesh.Format = static_cast<VertexFormat>(header.Format);
+
+        size_t vertexBytes = static_cast<size_t>(header.VertexCount) * header.VertexStride;
+        size_t indexBytes = static_cast<size_t>(header.IndexCount) * header.IndexSize;
+        size_t lodBytes = static_cast<size_t>(header.LodCount) * sizeof(Model::Lod);
+        size_t meshletBytes = static_cast<size_t>(header.MeshletCount) * sizeof(Model::Meshlet);
+
+        bool isKnownFormat =
+            mesh.Format == VertexFormat::Full || mesh.Format == VertexFormat::Compact;
+
+        bool isValid = header.Magic == MAGIC && header.Version == VERSION &&
+                       header.OptionsKey == optionsKey && isKnownFormat &&
+                       header.VertexStride == mesh.VertexStride() &&
+                       (header.IndexSize == sizeof(u16) || header.IndexSize == sizeof(u32)) &&
+                       cacheFile.Size() ==
+                           sizeof(Header) + vertexBytes + indexBytes + lodBytes + meshletBytes;
+
+        // A cache without its source is trusted as-is, which lets us ship caches alone.
+        if (hasSource) {
+            isValid = isValid && header.SourceHash == sourceHash && header.SourceSize == sourceSize;
+        }
+
+        if (!isValid) {
+            cacheFile.Close();
+            return false;
+        }
+
+        const u8 *payload = cacheFile.Data() + sizeof(Header);
+        mesh.Vertices = payload;
+        mesh.VertexCount = header.VertexCount;
+        mesh.Indices = payload + vertexBytes;
+        mesh.IndexCount = header.IndexCount;
+        mesh.IndexSize = header.IndexSize;
+
+        // Index data can end off a 4-byte boundary, so the records are copied out.
+        lods.resize(header.LodCount);
+        memcpy(lods.data(), payload + vertexBytes + indexBytes, lodBytes);
+        meshlets.resize(header.MeshletCount);
+        memcpy(meshlets.data(), payload + vertexBytes + indexBytes + lodBytes, meshletBytes);
+
+        for (const Model::Lod &lod : lods) {
+            if (static_cast<u64>(lod.FirstIndex) + lod.IndexCount > header.IndexCount ||
+                static_cast<u64>(lod.FirstMeshlet) + lod.MeshletCount > header.MeshletCount) {
+                cacheFile.Close();
+                return false;
+            }
+        }
+        for (const Model::Meshlet &meshlet : meshlets) {
+            if (static_cast<u64>(meshlet.FirstIndex) + meshlet.IndexCount > header.IndexCount) {
+                cacheFile.Close();
+                return false;
+            }
+        }
+        mesh.Lods = lods.data();
+        mesh.LodCount = header.LodCount;
+        mesh.Meshlets = meshlets.data();
+        mesh.MeshletCount = header.MeshletCount;
+        mesh.QuantizationOffset = {header.QuantizationOffset[0],
+                                   header.QuantizationOffset[1],
+                                   header.QuantizationOffset[2]};
+        mesh.QuantizationScale = {header.QuantizationScale[0],
+                                  header.QuantizationScale[1],
+                                  header.QuantizationScale[2]};
+        Mesh = mesh;
+        return true;
+    }
+
+    void MeshCache::Store(const Model::MeshView &mesh) {
+        if (!hasSource) {
+            return;
+        }
+
+        // Drop our view of any stale cache first; Windows refuses to replace a mapped file.
+        cacheFile.Close();
+        Mesh = {};
+
+        Header header{};
+        header.Magic = MAGIC;
+        header.Version = VERSION;
+        header.SourceHash = sourceHash;
+        header.SourceSize = sourceSize;
+        header.VertexStride = mesh.VertexStride();
+        header.VertexCount = mesh.VertexCount;
+        header.IndexCount = mesh.IndexCount;
+        header.OptionsKey = optionsKey;
+        header.Format = static_cast<u32>(mesh.Format);
+        header.IndexSize = mesh.IndexSize;
+        for (int axis = 0; axis < 3; ++axis) {
+            header.QuantizationOffset[axis] = mesh.QuantizationOffset[axis];
+            header.QuantizationScale[axis] = mesh.QuantizationScale[axis];
+        }
+        header.LodCount = mesh.LodCount;
+        header.MeshletCount = mesh.MeshletCount;
+
+        // Workers can store the same cache at once; each writes its own temp file and the last
+        // rename wins.
+        static std::atomic<u32> tempCounter{0};
+        std::string tempPath = cachePath + "." + std::to_string(tempCounter++) + ".tmp";
+        {
+            std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+            if (!file.is_open()) {
+                std::cerr << "Failed to write mesh cache: " << tempPath << std::endl;
+                return;
+            }
+
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(mesh.Vertices),
+                       static_cast<std::streamsize>(mesh.VertexCount) * mesh.VertexStride());
+            file.write(reinterpret_cast<const char *>(mesh.Indices),
+                       static_cast<std::streamsize>(mesh.IndexCount) * mesh.IndexSize);
+            file.write(reinterpret_cast<const char *>(mesh.Lods),
+                       static_cast<std::streamsize>(mesh.LodCount) * sizeof(Model::Lod));
+            file.write(reinterpret_cast<const char *>(mesh.Meshlets),
+                       static_cast<std::streamsize>(mesh.MeshletCount) * sizeof(Model::Meshlet));
+
+            if (!file.good()) {
+                std::cerr << "Failed to write mesh cache: " << tempPath << std::endl;
+                file.close();
+                std::remove(tempPath.c_str());
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error) {
+            std::cerr << "Failed to write mesh cache: " << cachePath << " (" << error.message()
+                      << ")" << std::endl;
+            std::remove(tempPath.c_str());
+        }
+    }
+
+    bool MeshCache::HashSource() {
+        MappedFile source;
+        if (!source.Open(sourcePath)) {
+            return false;
+        }
+
+        sourceSize = source.Size();
+        sourceHash = HashBytes(source.Data(), source.Size());
+        return true;
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "core.h"
+#include "mappedfile.h"
+#include "model.h"
+
+#include <string>
+#include <vector>
+
+namespace XIV::Render {
+    // Binary cache of a fully processed (deduplicated) mesh, stored next to its source file.
+    // Loading maps the cache file and hands out views straight into the mapping, so the vertex
+    // and index data is copied exactly once: from the page cache into the staging buffer.
+    class MeshCache {
+    public:
+        static constexpr u32 MAGIC = 0x48534D58; // "XMSH"
+        static constexpr u32 VERSION = 7;
+        static inline const char *EXTENSION = ".xmesh";
+
+        struct Header {
+            u32 Magic;
+            u32 Version;
+            u64 SourceHash;
+            u64 SourceSize;
+            u64 OptionsKey;
+            u32 VertexStride;
+            u32 VertexCount;
+            u32 IndexCount;
+            u32 Format;
+            u32 IndexSize;
+            float QuantizationOffset[3];
+            float QuantizationScale[3];
+            u32 LodCount;     // Lod records follow the index data
+            u32 MeshletCount; // then Meshlet records
+        };
+
+        // optionsKey identifies the processing applied to the stored mesh (see ModelLoadOptions)
+        // and is part of the cache file name.
+        MeshCache(const std::string &sourcePath, u64 optionsKey = 0);
+        MeshCache(const MeshCache &) = delete;
+        MeshCache &operator=(const MeshCache &) = delete;
+
+        // Maps the cache file and validates it against the current source file. On success, Mesh
+        // points into the mapping and stays valid for the lifetime of this object.
+        bool Load();
+        // Writes the mesh to disk (via a temp file + rename, so readers never observe a partially
+        // written cache). Failures are reported but never fatal.
+        void Store(const Model::MeshView &mesh);
+
+        Model::MeshView Mesh{};
+
+    private:
+        bool HashSource();
+
+        std::string sourcePath;
+        std::string cachePath;
+        u64 optionsKey = 0;
+
+        MappedFile cacheFile;
+        std::vector<Model::Lod> lods;
+        std::vector<Model::Meshlet> meshlets;
+        bool hasSource = false;
+        u64 sourceHash = 0;
+        u64 sourceSize = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
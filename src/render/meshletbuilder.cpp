@@ -0,0 +1,248 @@
+#include "meshletbuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace XIV::Render {
+    namespace {
+        // How much a triangle's normal disagreeing with the meshlet's counts against it, in units
+        // of new vertices. Keeps cones narrow without making meshlets ragged.
+        constexpr float CONE_WEIGHT = 0.25f;
+        // Distance from the meshlet's centroid breaks the remaining ties, so meshlets grow as
+        // round patches that share more vertices instead of strips.
+        constexpr float DISTANCE_WEIGHT = 0.5f;
+        constexpr u32 INVALID = std::numeric_limits<u32>::max();
+
+        void ComputeBounds(const std::vector<Model::Vertex> &vertices,
+                           const std::vector<u32> &indices,
+                           Model::Meshlet &meshlet,
+                           u32 localFirst) {
+            Vec3 minimum{std::numeric_limits<float>::max()};
+            Vec3 maximum{std::numeric_limits<float>::lowest()};
+            for (u32 i = localFirst; i < localFirst + meshlet.IndexCount; ++i) {
+                const Vec3 &position = vertices[indices[i]].Position;
+                for (int axis = 0; axis < 3; ++axis) {
+                    minimum[axis] = std::min(minimum[axis], position[axis]);
+                    maximum[axis] = std::max(maximum[axis], position[axis]);
+                }
+            }
+
+            meshlet.Center = 0.5f * (minimum + maximum);
+            meshlet.Radius = 0.0f;
+            for (u32 i = localFirst; i < localFirst + meshlet.IndexCount; ++i) {
+                float distance = Wrath::Length(vertices[indices[i]].Position - meshlet.Center);
+                meshlet.Radius = std::max(meshlet.Radius, distance);
+            }
+
+            // The cone axis is the mean face normal; its cutoff is the sine of the widest angle
+            // any face makes with it. Cones of 90 degrees or more can never be culled.
+            Vec3 axis{0.0f};
+            std::vector<Vec3> normals;
+            normals.reserve(meshlet.IndexCount / 3);
+            for (u32 i = localFirst; i < localFirst + meshlet.IndexCount; i += 3) {
+                const Vec3 &p0 = vertices[indices[i]].Position;
+                Vec3 normal = Wrath::Cross(vertices[indices[i + 1]].Position - p0,
+                                           vertices[indices[i + 2]].Position - p0);
+                float length = Wrath::Length(normal);
+                if (length > 0.0f) {
+                    normals.push_back(normal / length);
+                    axis += normals.back();
+                }
+            }
+
+            float axisLength = Wrath::Length(axis);
+            if (normals.empty() || axisLength == 0.0f) {
+                return;
+            }
+            axis = axis / axisLength;
+
+            float minDot = 1.0f;
+            for (const Vec3 &normal : normals) {
+                minDot = std::min(minDot, Wrath::Dot(normal, axis));
+            }
+            if (minDot <= 0.0f) {
+                return;
+            }
+
+            meshlet.ConeAxis = axis;
+            meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+    } // namespace
+
+    void MeshletBuilder::Build(Model::Builder &builder) {
+        builder.Meshlets.clear();
+        if (builder.Lods.empty()) {
+            BuildRange(builder.Vertices, builder.Indices, 0, builder.Meshlets);
+            return;
+        }
+
+        std::vector<u32> range;
+        for (Model::Lod &lod : builder.Lods) {
+            auto first = builder.Indices.begin() + lod.FirstIndex;
+            range.assign(first, first + lod.IndexCount);
+
+            lod.FirstMeshlet = static_cast<u32>(builder.Meshlets.size());
+            BuildRange(builder.Vertices, range, lod.FirstIndex, builder.Meshlets);
+            lod.MeshletCount = static_cast<u32>(builder.Meshlets.size()) - lod.FirstMeshlet;
+
+            std::copy(range.begin(), range.end(), first);
+        }
+    }
+
+    void MeshletBuilder::BuildRange(const std::vector<Model::Vertex> &vertices,
+                                    std::vector<u32> &indices,
+                                    u32 firstIndex,
+                                    std::vector<Model::Meshlet> &meshlets) {
+        u32 triangleCount = static_cast<u32>(indices.size() / 3);
+        if (triangleCount == 0) {
+            return;
+        }
+        u32 vertexCount = static_cast<u32>(vertices.size());
+
+        // Vertex -> triangle adjacency.
+        std::vector<u32> offsets(vertexCount + 1, 0);
+        for (u32 i = 0; i < triangleCount * 3; ++i) {
+            ++offsets[indices[i] + 1];
+        }
+        for (u32 v = 0; v < vertexCount; ++v) {
+            offsets[v + 1] += offsets[v];
+        }
+        std::vector<u32> adjacency(triangleCount * 3);
+        {
+            std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+            for (u32 t = 0; t < triangleCount; ++t) {
+                for (u32 k = 0; k < 3; ++k) {
+                    adjacency[fill[indices[3 * t + k]]++] = t;
+                }
+            }
+        }
+
+        std::vector<Vec3> normals(triangleCount);
+        std::vector<Vec3> centroids(triangleCount);
+        float edgeSum = 0.0f;
+        for (u32 t = 0; t < triangleCount; ++t) {
+            const Vec3 &p0 = vertices[indices[3 * t]].Position;
+            const Vec3 &p1 = vertices[indices[3 * t + 1]].Position;
+            const Vec3 &p2 = vertices[indices[3 * t + 2]].Position;
+            Vec3 normal = Wrath::Cross(p1 - p0, p2 - p0);
+            float length = Wrath::Length(normal);
+            normals[t] = length > 0.0f ? normal / length : Vec3{0.0f};
+            centroids[t] = (p0 + p1 + p2) / 3.0f;
+            edgeSum += Wrath::Length(p1 - p0);
+        }
+        float edgeLength = std::max(edgeSum / triangleCount, std::numeric_limits<float>::min());
+
+        std::vector<bool> isEmitted(triangleCount, false);
+        std::vector<u32> meshletOf(vertexCount, INVALID); // meshlet a vertex was last added to
+        std::vector<u32> ordered;
+        ordered.reserve(indices.size());
+
+        std::vector<u32> meshletVertices;
+        std::vector<u32> meshletTriangles;
+        u32 seed = 0;
+        u32 meshletId = 0;
+
+        for (u32 emitted = 0; emitted < triangleCount; ++meshletId) {
+            while (isEmitted[seed]) {
+                ++seed;
+            }
+
+            meshletVertices.clear();
+            meshletTriangles.clear();
+            Vec3 normalSum{0.0f};
+            Vec3 centroidSum{0.0f};
+
+            auto newVertexCount = [&](u32 t) {
+                u32 count = 0;
+                for (u32 k = 0; k < 3; ++k) {
+                    count += meshletOf[indices[3 * t + k]] != meshletId ? 1 : 0;
+                }
+                return count;
+            };
+
+            auto add = [&](u32 t) {
+                for (u32 k = 0; k < 3; ++k) {
+                    u32 v = indices[3 * t + k];
+                    if (meshletOf[v] != meshletId) {
+                        meshletOf[v] = meshletId;
+                        meshletVertices.push_back(v);
+                    }
+                }
+                meshletTriangles.push_back(t);
+                normalSum += normals[t];
+                centroidSum += centroids[t];
+                isEmitted[t] = true;
+                ++emitted;
+            };
+
+            // Picks the unused neighbor of the given vertices that grows the meshlet least.
+            auto findNext = [&](const u32 *candidates, size_t count) {
+                float normalLength = Wrath::Length(normalSum);
+                Vec3 axis = normalLength > 0.0f ? normalSum / normalLength : Vec3{0.0f};
+                float triangles = static_cast<float>(meshletTriangles.size());
+                Vec3 centroid = centroidSum / triangles;
+                // Roughly the radius of a round patch of this many triangles.
+                float patchRadius = edgeLength * (1.0f + std::sqrt(triangles));
+
+                u32 best = INVALID;
+                float bestScore = std::numeric_limits<float>::max();
+                for (size_t c = 0; c < count; ++c) {
+                    u32 v = candidates[c];
+                    for (u32 i = offsets[v]; i < offsets[v + 1]; ++i) {
+                        u32 t = adjacency[i];
+                        if (isEmitted[t]) {
+                            continue;
+                        }
+                        u32 extra = newVertexCount(t);
+                        if (meshletVertices.size() + extra > MAX_VERTICES) {
+                            continue;
+                        }
+                        float distance = Wrath::Length(centroids[t] - centroid) / patchRadius;
+                        float score = extra +
+                                      CONE_WEIGHT * (1.0f - Wrath::Dot(normals[t], axis)) +
+                                      DISTANCE_WEIGHT * std::min(distance, 1.0f);
+                        if (score < bestScore) {
+                            bestScore = score;
+                            best = t;
+                        }
+                    }
+                }
+                return best;
+            };
+
+            add(seed);
+            while (meshletTriangles.size() < MAX_TRIANGLES) {
+                // Neighbors of the newest triangle keep the meshlet growing in one place; the
+                // whole boundary is only searched when those run out.
+                const u32 *last = &indices[3 * meshletTriangles.back()];
+                u32 next = findNext(last, 3);
+                if (next == INVALID) {
+                    next = findNext(meshletVertices.data(), meshletVertices.size());
+                }
+                if (next == INVALID) {
+                    break;
+                }
+                add(next);
+            }
+
+            Model::Meshlet meshlet{};
+            u32 localFirst = static_cast<u32>(ordered.size());
+            meshlet.FirstIndex = firstIndex + localFirst;
+            meshlet.IndexCount = static_cast<u32>(meshletTriangles.size() * 3);
+            for (u32 t : meshletTriangles) {
+                ordered.insert(ordered.end(), &indices[3 * t], &indices[3 * t] + 3);
+            }
+            ComputeBounds(vertices, ordered, meshlet, localFirst);
+            meshlets.push_back(meshlet);
+        }
+
+        indices = std::move(ordered);
+    }
+
+    bool MeshletBuilder::IsBackfacing(const Model::Meshlet &meshlet, const Vec3 &viewer) {
+        Vec3 toCenter = meshlet.Center - viewer;
+        return Wrath::Dot(toCenter, meshlet.ConeAxis) >=
+               meshlet.ConeCutoff * Wrath::Length(toCenter) + meshlet.Radius;
+    }
+} // namespace XIV::Render
\ No newline at end of file
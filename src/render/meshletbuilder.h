@@ -0,0 +1,33 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include "core.h"
+#include "model.h"
+
+#include <vector>
+
+namespace XIV::Render {
+    // Splits a mesh into meshlets: clusters of neighboring triangles small enough to cull one at
+    // a time. Triangles are reordered so each meshlet is a contiguous index range, so no extra
+    // index data is needed and the usual index buffer draws them.
+    class MeshletBuilder {
+    public:
+        static constexpr u32 MAX_VERTICES = 64;
+        static constexpr u32 MAX_TRIANGLES = 124;
+
+        // Builds meshlets for every level of detail in builder (or the whole index buffer when
+        // there are none) and records each level's meshlet range.
+        static void Build(Model::Builder &builder);
+
+        // Reorders the triangles of indices into meshlets and appends those meshlets.
+        static void BuildRange(const std::vector<Model::Vertex> &vertices,
+                               std::vector<u32> &indices,
+                               u32 firstIndex,
+                               std::vector<Model::Meshlet> &meshlets);
+
+        // True when every triangle of the meshlet faces away from an object-space viewer.
+        static bool IsBackfacing(const Model::Meshlet &meshlet, const Vec3 &viewer);
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
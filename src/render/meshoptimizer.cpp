@@ -0,0 +1,412 @@
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace XIV::Render {
+    namespace {
+        // Forsyth's tuning constants. The cache is modelled as LRU and deliberately larger than
+        // any real hardware cache, which keeps the result good across GPUs.
+        constexpr u32 FORSYTH_CACHE_SIZE = 32;
+        constexpr u32 MAX_VALENCE = 32;
+        constexpr float CACHE_DECAY_POWER = 1.5f;
+        constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+        constexpr float VALENCE_BOOST_SCALE = 2.0f;
+        constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+        struct ScoreTables {
+            float Position[FORSYTH_CACHE_SIZE];
+            float Valence[MAX_VALENCE + 1];
+
+            ScoreTables() {
+                for (u32 i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+                    if (i < 3) {
+                        Position[i] = LAST_TRIANGLE_SCORE;
+                    } else {
+                        float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                        Position[i] = std::pow(1.0f - (i - 3) * scale, CACHE_DECAY_POWER);
+                    }
+                }
+
+                Valence[0] = 0.0f;
+                for (u32 i = 1; i <= MAX_VALENCE; ++i) {
+                    Valence[i] = VALENCE_BOOST_SCALE *
+                                 std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+                }
+            }
+        };
+
+        float VertexScore(const ScoreTables &tables, i32 cachePosition, u32 remaining) {
+            if (remaining == 0) {
+                // No triangles left to pull in; never worth choosing.
+                return -1.0f;
+            }
+
+            float score = 0.0f;
+            if (cachePosition >= 0) {
+                score += tables.Position[cachePosition];
+            }
+            return score + tables.Valence[std::min(remaining, MAX_VALENCE)];
+        }
+
+        struct Cluster {
+            u32 FirstTriangle = 0;
+            u32 TriangleCount = 0;
+            float SortKey = 0.0f;
+        };
+
+        struct Range {
+            u32 FirstIndex = 0;
+            u32 IndexCount = 0;
+        };
+
+        // Calls fn on every index range that is drawn on its own: each meshlet when there are
+        // any, else each level of detail, else the whole mesh. Ranges are renumbered to their own
+        // vertices first, so the work per meshlet scales with the meshlet, not the mesh.
+        template <typename Fn>
+        void ForEachRange(Model::Builder &builder, const Fn &fn) {
+            std::vector<Range> ranges;
+            if (!builder.Meshlets.empty()) {
+                for (const Model::Meshlet &meshlet : builder.Meshlets) {
+                    ranges.push_back({meshlet.FirstIndex, meshlet.IndexCount});
+                }
+            } else if (!builder.Lods.empty()) {
+                for (const Model::Lod &lod : builder.Lods) {
+                    ranges.push_back({lod.FirstIndex, lod.IndexCount});
+                }
+            } else {
+                ranges.push_back({0, static_cast<u32>(builder.Indices.size())});
+            }
+
+            std::vector<u32> localOf(builder.Vertices.size(), UINT32_MAX);
+            std::vector<u32> globalOf;
+            std::vector<u32> indices;
+            std::vector<Model::Vertex> vertices;
+            for (const Range &range : ranges) {
+                globalOf.clear();
+                indices.clear();
+                vertices.clear();
+                for (u32 i = range.FirstIndex; i < range.FirstIndex + range.IndexCount; ++i) {
+                    u32 v = builder.Indices[i];
+                    if (localOf[v] == UINT32_MAX) {
+                        localOf[v] = static_cast<u32>(globalOf.size());
+                        globalOf.push_back(v);
+                        vertices.push_back(builder.Vertices[v]);
+                    }
+                    indices.push_back(localOf[v]);
+                }
+
+                fn(indices, vertices);
+
+                for (size_t i = 0; i < indices.size(); ++i) {
+                    builder.Indices[range.FirstIndex + i] = globalOf[indices[i]];
+                }
+                for (u32 v : globalOf) {
+                    localOf[v] = UINT32_MAX;
+                }
+            }
+        }
+    } // namespace
+
+    MeshOptimizer::Result MeshOptimizer::Optimize(Model::Builder &builder,
+                                                  const ModelLoadOptions &options) {
+        u32 vertexCount = static_cast<u32>(builder.Vertices.size());
+        if (builder.Indices.size() < 3 ||
+            !(options.OptimizeVertexCache || options.OptimizeOverdraw ||
+              options.OptimizeVertexFetch)) {
+            return {};
+        }
+
+        Result result{};
+        result.Before = Analyze(builder.Indices, vertexCount);
+
+        // Meshlets and levels of detail are drawn on their own, so triangles are only reordered
+        // within them; their ranges stay valid.
+        if (options.OptimizeVertexCache) {
+            ForEachRange(builder,
+                         [](std::vector<u32> &indices, const std::vector<Model::Vertex> &vertices) {
+                             OptimizeVertexCache(indices, static_cast<u32>(vertices.size()));
+                         });
+        }
+        if (options.OptimizeOverdraw) {
+            ForEachRange(builder,
+                         [&options](std::vector<u32> &indices,
+                                    const std::vector<Model::Vertex> &vertices) {
+                             OptimizeOverdraw(indices, vertices, options.OverdrawThreshold);
+                         });
+        }
+        if (options.OptimizeVertexFetch) {
+            OptimizeVertexFetch(builder.Vertices, builder.Indices);
+        }
+
+        result.After = Analyze(builder.Indices, static_cast<u32>(builder.Vertices.size()));
+        return result;
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(std::vector<u32> &indices, u32 vertexCount) {
+        static const ScoreTables tables{};
+
+        u32 triangleCount = static_cast<u32>(indices.size() / 3);
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // Vertex -> triangle adjacency. The first remaining[v] entries of each vertex's range
+        // are the triangles not yet emitted.
+        std::vector<u32> remaining(vertexCount, 0);
+        for (u32 index : indices) {
+            ++remaining[index];
+        }
+
+        std::vector<u32> offsets(vertexCount + 1, 0);
+        for (u32 v = 0; v < vertexCount; ++v) {
+            offsets[v + 1] = offsets[v] + remaining[v];
+        }
+
+        std::vector<u32> adjacency(indices.size());
+        {
+            std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+            for (u32 t = 0; t < triangleCount; ++t) {
+                for (u32 k = 0; k < 3; ++k) {
+                    u32 v = indices[3 * t + k];
+                    adjacency[fill[v]++] = t;
+                }
+            }
+        }
+
+        std::vector<i32> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (u32 v = 0; v < vertexCount; ++v) {
+            vertexScores[v] = VertexScore(tables, -1, remaining[v]);
+        }
+
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> isEmitted(triangleCount, false);
+        u32 bestTriangle = 0;
+        for (u32 t = 0; t < triangleCount; ++t) {
+            triangleScores[t] = vertexScores[indices[3 * t + 0]] +
+                                vertexScores[indices[3 * t + 1]] +
+                                vertexScores[indices[3 * t + 2]];
+            if (triangleScores[t] > triangleScores[bestTriangle]) {
+                bestTriangle = t;
+            }
+        }
+
+        std::vector<u32> output;
+        output.reserve(indices.size());
+
+        u32 cache[FORSYTH_CACHE_SIZE + 3];
+        u32 cacheCount = 0;
+        u32 nextCandidate = 0;
+
+        while (output.size() < indices.size()) {
+            if (bestTriangle == UINT32_MAX) {
+                // Nothing in the cache is adjacent to unemitted work: restart at the next
+                // triangle in input order.
+                while (isEmitted[nextCandidate]) {
+                    ++nextCandidate;
+                }
+                bestTriangle = nextCandidate;
+            }
+
+            const u32 *triangle = &indices[3 * bestTriangle];
+            isEmitted[bestTriangle] = true;
+            output.insert(output.end(), triangle, triangle + 3);
+
+            for (u32 k = 0; k < 3; ++k) {
+                u32 v = triangle[k];
+                u32 *begin = &adjacency[offsets[v]];
+                u32 *end = begin + remaining[v];
+                u32 *it = std::find(begin, end, bestTriangle);
+                std::swap(*it, *(end - 1));
+                --remaining[v];
+            }
+
+            // Move the triangle's vertices to the front of the LRU cache.
+            u32 newCache[FORSYTH_CACHE_SIZE + 3];
+            u32 newCount = 0;
+            for (u32 k = 0; k < 3; ++k) {
+                newCache[newCount++] = triangle[k];
+            }
+            for (u32 i = 0; i < cacheCount; ++i) {
+                u32 v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                    newCache[newCount++] = v;
+                }
+            }
+
+            // Rescore everything whose cache position changed, including the vertices that just
+            // fell off the end, and find the best triangle that touches the cache.
+            bestTriangle = UINT32_MAX;
+            float bestScore = -1.0f;
+            for (u32 i = 0; i < newCount; ++i) {
+                u32 v = newCache[i];
+                i32 position = i < FORSYTH_CACHE_SIZE ? static_cast<i32>(i) : -1;
+                cachePositions[v] = position;
+
+                float score = VertexScore(tables, position, remaining[v]);
+                float delta = score - vertexScores[v];
+                vertexScores[v] = score;
+
+                for (u32 j = 0; j < remaining[v]; ++j) {
+                    u32 t = adjacency[offsets[v] + j];
+                    triangleScores[t] += delta;
+                    if (triangleScores[t] > bestScore) {
+                        bestScore = triangleScores[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+            std::copy(newCache, newCache + cacheCount, cache);
+        }
+
+        indices.swap(output);
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(std::vector<u32> &indices,
+                                         const std::vector<Model::Vertex> &vertices,
+                                         float threshold) {
+        u32 triangleCount = static_cast<u32>(indices.size() / 3);
+        if (triangleCount < 2) {
+            return;
+        }
+
+        // A triangle whose three vertices all miss the cache starts a new cluster; reordering
+        // whole clusters then costs almost nothing in cache efficiency.
+        std::vector<Cluster> clusters;
+        {
+            std::vector<u32> timestamps(vertices.size(), 0);
+            u32 time = REPORT_CACHE_SIZE + 1;
+            for (u32 t = 0; t < triangleCount; ++t) {
+                u32 misses = 0;
+                for (u32 k = 0; k < 3; ++k) {
+                    u32 v = indices[3 * t + k];
+                    if (time - timestamps[v] > REPORT_CACHE_SIZE) {
+                        timestamps[v] = time++;
+                        ++misses;
+                    }
+                }
+
+                if (t == 0 || misses == 3) {
+                    clusters.push_back(Cluster{t, 0});
+                }
+                ++clusters.back().TriangleCount;
+            }
+        }
+
+        if (clusters.size() < 2) {
+            return;
+        }
+
+        // Sort by how far each cluster faces outward from the mesh center, so outer surfaces are
+        // drawn first and occlude what lies behind them.
+        std::vector<Vec3> centroids(clusters.size());
+        std::vector<Vec3> normals(clusters.size());
+        Vec3 meshCentroid{0.0f};
+        float meshArea = 0.0f;
+
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            Vec3 centroid{0.0f};
+            Vec3 normal{0.0f};
+            float area = 0.0f;
+
+            for (u32 t = clusters[c].FirstTriangle;
+                 t < clusters[c].FirstTriangle + clusters[c].TriangleCount;
+                 ++t) {
+                const Vec3 &a = vertices[indices[3 * t + 0]].Position;
+                const Vec3 &b = vertices[indices[3 * t + 1]].Position;
+                const Vec3 &d = vertices[indices[3 * t + 2]].Position;
+
+                Vec3 cross = Wrath::Cross(b - a, d - a);
+                float triangleArea = Wrath::Length(cross);
+                centroid += (a + b + d) * (triangleArea / 3.0f);
+                normal += cross;
+                area += triangleArea;
+            }
+
+            centroids[c] = area > 0.0f
+                               ? centroid / area
+                               : vertices[indices[3 * clusters[c].FirstTriangle]].Position;
+            float normalLength = Wrath::Length(normal);
+            normals[c] = normalLength > 0.0f ? normal / normalLength : Vec3{0.0f};
+            meshCentroid += centroid;
+            meshArea += area;
+        }
+
+        if (meshArea > 0.0f) {
+            meshCentroid /= meshArea;
+        }
+
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            clusters[c].SortKey = Wrath::Dot(centroids[c] - meshCentroid, normals[c]);
+        }
+
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+            return a.SortKey > b.SortKey;
+        });
+
+        std::vector<u32> output;
+        output.reserve(indices.size());
+        for (const Cluster &cluster : clusters) {
+            auto begin = indices.begin() + 3 * static_cast<size_t>(cluster.FirstTriangle);
+            output.insert(
+                output.end(), begin, begin + 3 * static_cast<size_t>(cluster.TriangleCount));
+        }
+
+        u32 vertexCount = static_cast<u32>(vertices.size());
+        if (Analyze(output, vertexCount).Acmr <= Analyze(indices, vertexCount).Acmr * threshold) {
+            indices.swap(output);
+        }
+    }
+
+    void MeshOptimizer::OptimizeVertexFetch(std::vector<Model::Vertex> &vertices,
+                                            std::vector<u32> &indices) {
+        std::vector<u32> remap(vertices.size(), UINT32_MAX);
+        std::vector<Model::Vertex> reordered;
+        reordered.reserve(vertices.size());
+
+        for (u32 &index : indices) {
+            if (remap[index] == UINT32_MAX) {
+                remap[index] = static_cast<u32>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        vertices.swap(reordered);
+    }
+
+    MeshOptimizer::Stats MeshOptimizer::Analyze(const std::vector<u32> &indices,
+                                                u32 vertexCount,
+                                                u32 cacheSize) {
+        Stats stats{};
+        if (indices.empty()) {
+            return stats;
+        }
+
+        // FIFO cache simulation: a vertex is resident while fewer than cacheSize misses have
+        // happened since it was loaded.
+        std::vector<u32> timestamps(vertexCount, 0);
+        std::vector<bool> isReferenced(vertexCount, false);
+        u32 time = cacheSize + 1;
+        u32 misses = 0;
+        u32 referenced = 0;
+
+        for (u32 index : indices) {
+            if (time - timestamps[index] > cacheSize) {
+                timestamps[index] = time++;
+                ++misses;
+            }
+            if (!isReferenced[index]) {
+                isReferenced[index] = true;
+                ++referenced;
+            }
+        }
+
+        stats.Acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        stats.Atvr = static_cast<float>(misses) / static_cast<float>(referenced);
+        return stats;
+    }
+} // namespace XIV::Render
\ No newline at end of file
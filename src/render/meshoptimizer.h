@@ -0,0 +1,49 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "core.h"
+#include "model.h"
+
+#include <vector>
+
+namespace XIV::Render {
+    // Post-load reordering of a Builder's triangles and vertices for the GPU.
+    class MeshOptimizer {
+    public:
+        // FIFO size used for ACMR/ATVR reporting; a typical post-transform cache size.
+        static constexpr u32 REPORT_CACHE_SIZE = 16;
+
+        struct Stats {
+            float Acmr = 0.0f; // transformed vertices per triangle (0.5 ideal, 3 worst)
+            float Atvr = 0.0f; // transformed vertices per referenced vertex (1 ideal)
+        };
+
+        struct Result {
+            Stats Before{};
+            Stats After{};
+        };
+
+        // Runs the passes enabled in options and returns the stats before and after; both are
+        // zero when no pass is enabled. Run it after MeshletBuilder::Build, which picks its own
+        // triangle order; triangles are then only reordered within each meshlet.
+        static Result Optimize(Model::Builder &builder, const ModelLoadOptions &options);
+
+        // Tom Forsyth's linear-speed vertex cache optimization.
+        static void OptimizeVertexCache(std::vector<u32> &indices, u32 vertexCount);
+        // Splits cache-ordered triangles into clusters at cache restarts and sorts the clusters
+        // front-to-back from the outside in. The new order is dropped if it raises ACMR by more
+        // than the given factor.
+        static void OptimizeOverdraw(std::vector<u32> &indices,
+                                     const std::vector<Model::Vertex> &vertices,
+                                     float threshold);
+        // Renumbers vertices in first-use order, dropping unreferenced ones.
+        static void OptimizeVertexFetch(std::vector<Model::Vertex> &vertices,
+                                        std::vector<u32> &indices);
+
+        static Stats Analyze(const std::vector<u32> &indices,
+                             u32 vertexCount,
+                             u32 cacheSize = REPORT_CACHE_SIZE);
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
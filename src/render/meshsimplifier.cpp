@@ -0,0 +1,511 @@
+#include "meshsimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace XIV::Render {
+    namespace {
+        // Border edges are held in place by an extra plane perpendicular to their face, weighted
+        // well above the surface planes so open edges keep their outline.
+        constexpr float BORDER_WEIGHT = 10.0f;
+        // A collapse is rejected if it turns any surrounding triangle further than this (cosine).
+        constexpr float MIN_NORMAL_DOT = 0.25f;
+        // Triangles flatter than this (sine of their smallest angle, roughly) count as collapsed.
+        constexpr float MIN_SLIVER_SINE = 1e-3f;
+        // A level has to drop at least this fraction of the previous level's triangles.
+        constexpr float MIN_LOD_REDUCTION = 0.1f;
+
+        enum class VertexKind : u8 {
+            Manifold, // interior vertex, may collapse onto any neighbor
+            Border,   // on an open edge, may only slide along it
+            Locked,   // non-manifold, never moves
+        };
+
+        // Symmetric 4x4 error quadric (A, b, c) with the total weight of its planes.
+        struct Quadric {
+            float A00 = 0.0f, A11 = 0.0f, A22 = 0.0f;
+            float A10 = 0.0f, A20 = 0.0f, A21 = 0.0f;
+            float B0 = 0.0f, B1 = 0.0f, B2 = 0.0f;
+            float C = 0.0f;
+            float Weight = 0.0f;
+
+            void AddPlane(Vec3 normal, float distance, float weight) {
+                A00 += weight * normal.x * normal.x;
+                A11 += weight * normal.y * normal.y;
+                A22 += weight * normal.z * normal.z;
+                A10 += weight * normal.y * normal.x;
+                A20 += weight * normal.z * normal.x;
+                A21 += weight * normal.z * normal.y;
+                B0 += weight * normal.x * distance;
+                B1 += weight * normal.y * distance;
+                B2 += weight * normal.z * distance;
+                C += weight * distance * distance;
+                Weight += weight;
+            }
+
+            void Add(const Quadric &other) {
+                A00 += other.A00;
+                A11 += other.A11;
+                A22 += other.A22;
+                A10 += other.A10;
+                A20 += other.A20;
+                A21 += other.A21;
+                B0 += other.B0;
+                B1 += other.B1;
+                B2 += other.B2;
+                C += other.C;
+                Weight += other.Weight;
+            }
+
+            // Weighted mean squared distance from p to the accumulated planes.
+            float Error(Vec3 p) const {
+                float rx = A00 * p.x + A10 * p.y + A20 * p.z;
+                float ry = A10 * p.x + A11 * p.y + A21 * p.z;
+                float rz = A20 * p.x + A21 * p.y + A22 * p.z;
+                float error = p.x * rx + p.y * ry + p.z * rz +
+                              2.0f * (B0 * p.x + B1 * p.y + B2 * p.z) + C;
+                return std::abs(error) / std::max(Weight, std::numeric_limits<float>::min());
+            }
+        };
+
+        u64 EdgeKey(u32 a, u32 b) {
+            return a < b ? (static_cast<u64>(a) << 32) | b : (static_cast<u64>(b) << 32) | a;
+        }
+
+        // Runs collapses in passes. Topology is tracked per unique position so that attribute
+        // seams (split normals, uv islands) do not pin the surface; when a position collapses,
+        // each of its vertices is replaced by the closest-matching vertex at the target.
+        class QuadricSimplifier {
+        public:
+            QuadricSimplifier(const std::vector<Model::Vertex> &vertices,
+                              const std::vector<u32> &indices)
+                : vertices{vertices}, indices{indices} {
+                WeldPositions();
+                InitializeQuadrics();
+            }
+
+            void Collapse(size_t targetIndexCount) {
+                while (indices.size() > targetIndexCount) {
+                    if (!CollapsePass(targetIndexCount)) {
+                        break;
+                    }
+                }
+            }
+
+            const std::vector<u32> &Indices() const {
+                return indices;
+            }
+
+            // Largest collapse error so far, converted back to object space.
+            float Error() const {
+                return std::sqrt(maxError) * extent;
+            }
+
+        private:
+            struct Edge {
+                u32 A;
+                u32 B;
+                u32 Count; // triangles using the edge
+            };
+
+            struct Candidate {
+                u32 From;
+                u32 To;
+                float Cost;
+            };
+
+            void WeldPositions() {
+                u32 vertexCount = static_cast<u32>(vertices.size());
+
+                Vec3 minimum{std::numeric_limits<float>::max()};
+                Vec3 maximum{std::numeric_limits<float>::lowest()};
+                for (const auto &vertex : vertices) {
+                    for (int axis = 0; axis < 3; ++axis) {
+                        minimum[axis] = std::min(minimum[axis], vertex.Position[axis]);
+                        maximum[axis] = std::max(maximum[axis], vertex.Position[axis]);
+                    }
+                }
+                extent = std::max({maximum.x - minimum.x,
+                                   maximum.y - minimum.y,
+                                   maximum.z - minimum.z,
+                                   std::numeric_limits<float>::min()});
+
+                std::vector<u32> order(vertexCount);
+                for (u32 i = 0; i < vertexCount; ++i) {
+                    order[i] = i;
+                }
+                auto lessPosition = [this](u32 a, u32 b) {
+                    const Vec3 &pa = vertices[a].Position;
+                    const Vec3 &pb = vertices[b].Position;
+                    if (pa.x != pb.x) {
+                        return pa.x < pb.x;
+                    }
+                    if (pa.y != pb.y) {
+                        return pa.y < pb.y;
+                    }
+                    return pa.z < pb.z;
+                };
+                std::sort(order.begin(), order.end(), lessPosition);
+
+                positionOf.assign(vertexCount, 0);
+                for (u32 i = 0; i < vertexCount; ++i) {
+                    if (i == 0 || lessPosition(order[i - 1], order[i])) {
+                        positions.push_back((vertices[order[i]].Position - minimum) / extent);
+                    }
+                    positionOf[order[i]] = static_cast<u32>(positions.size() - 1);
+                }
+
+                // Vertices grouped by position; order is already sorted by position.
+                u32 positionCount = static_cast<u32>(positions.size());
+                wedgeOffsets.assign(positionCount + 1, 0);
+                for (u32 i = 0; i < vertexCount; ++i) {
+                    ++wedgeOffsets[positionOf[i] + 1];
+                }
+                for (u32 p = 0; p < positionCount; ++p) {
+                    wedgeOffsets[p + 1] += wedgeOffsets[p];
+                }
+                wedges = std::move(order);
+            }
+
+            void InitializeQuadrics() {
+                quadrics.assign(positions.size(), Quadric{});
+
+                std::vector<Edge> edges;
+                BuildEdges(edges);
+
+                for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                    u32 corners[3] = {positionOf[indices[i]],
+                                      positionOf[indices[i + 1]],
+                                      positionOf[indices[i + 2]]};
+                    const Vec3 &p0 = positions[corners[0]];
+                    Vec3 normal = Wrath::Cross(positions[corners[1]] - p0,
+                                               positions[corners[2]] - p0);
+                    float length = Wrath::Length(normal);
+                    if (length == 0.0f) {
+                        continue;
+                    }
+                    normal = normal / length;
+
+                    float area = 0.5f * length;
+                    float distance = -Wrath::Dot(normal, p0);
+                    for (u32 corner : corners) {
+                        quadrics[corner].AddPlane(normal, distance, area);
+                    }
+
+                    for (u32 k = 0; k < 3; ++k) {
+                        u32 a = corners[k];
+                        u32 b = corners[(k + 1) % 3];
+                        if (FindEdge(edges, a, b).Count != 1) {
+                            continue;
+                        }
+
+                        Vec3 edge = positions[b] - positions[a];
+                        float edgeLength = Wrath::Length(edge);
+                        if (edgeLength == 0.0f) {
+                            continue;
+                        }
+                        Vec3 borderNormal = Wrath::Normalize(Wrath::Cross(edge, normal));
+                        float borderDistance = -Wrath::Dot(borderNormal, positions[a]);
+                        float weight = BORDER_WEIGHT * edgeLength * edgeLength;
+                        quadrics[a].AddPlane(borderNormal, borderDistance, weight);
+                        quadrics[b].AddPlane(borderNormal, borderDistance, weight);
+                    }
+                }
+            }
+
+            // Unique position-level edges of the current triangles, sorted by key.
+            void BuildEdges(std::vector<Edge> &edges) const {
+                std::vector<u64> keys;
+                keys.reserve(indices.size());
+                for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                    for (u32 k = 0; k < 3; ++k) {
+                        u32 a = positionOf[indices[i + k]];
+                        u32 b = positionOf[indices[i + (k + 1) % 3]];
+                        keys.push_back(EdgeKey(a, b));
+                    }
+                }
+                std::sort(keys.begin(), keys.end());
+
+                edges.clear();
+                for (size_t i = 0; i < keys.size();) {
+                    size_t end = i + 1;
+                    while (end < keys.size() && keys[end] == keys[i]) {
+                        ++end;
+                    }
+                    edges.push_back(Edge{static_cast<u32>(keys[i] >> 32),
+                                         static_cast<u32>(keys[i] & 0xFFFFFFFFu),
+                                         static_cast<u32>(end - i)});
+                    i = end;
+                }
+            }
+
+            static const Edge &FindEdge(const std::vector<Edge> &edges, u32 a, u32 b) {
+                u64 key = EdgeKey(a, b);
+                auto it = std::lower_bound(
+                    edges.begin(), edges.end(), key, [](const Edge &edge, u64 value) {
+                        return EdgeKey(edge.A, edge.B) < value;
+                    });
+                return *it;
+            }
+
+            bool CollapsePass(size_t targetIndexCount) {
+                u32 positionCount = static_cast<u32>(positions.size());
+
+                std::vector<Edge> edges;
+                BuildEdges(edges);
+
+                // Classify positions from the current topology.
+                std::vector<VertexKind> kinds(positionCount, VertexKind::Manifold);
+                std::vector<u8> borderEdgeCounts(positionCount, 0);
+                for (const Edge &edge : edges) {
+                    if (edge.Count > 2) {
+                        kinds[edge.A] = VertexKind::Locked;
+                        kinds[edge.B] = VertexKind::Locked;
+                    } else if (edge.Count == 1) {
+                        borderEdgeCounts[edge.A] = std::min(borderEdgeCounts[edge.A] + 1, 255);
+                        borderEdgeCounts[edge.B] = std::min(borderEdgeCounts[edge.B] + 1, 255);
+                    }
+                }
+                for (u32 p = 0; p < positionCount; ++p) {
+                    if (kinds[p] == VertexKind::Manifold && borderEdgeCounts[p] > 0) {
+                        // Two border edges make a simple boundary; anything else is a pinch.
+                        kinds[p] = borderEdgeCounts[p] == 2 ? VertexKind::Border
+                                                            : VertexKind::Locked;
+                    }
+                }
+
+                // Position -> triangle adjacency for the flip test.
+                u32 triangleCount = static_cast<u32>(indices.size() / 3);
+                std::vector<u32> triangleOffsets(positionCount + 1, 0);
+                for (u32 index : indices) {
+                    ++triangleOffsets[positionOf[index] + 1];
+                }
+                for (u32 p = 0; p < positionCount; ++p) {
+                    triangleOffsets[p + 1] += triangleOffsets[p];
+                }
+                std::vector<u32> adjacency(indices.size());
+                {
+                    std::vector<u32> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+                    for (u32 t = 0; t < triangleCount; ++t) {
+                        for (u32 k = 0; k < 3; ++k) {
+                            adjacency[fill[positionOf[indices[3 * t + k]]]++] = t;
+                        }
+                    }
+                }
+
+                auto canMove = [&kinds](u32 from, bool isBorderEdge) {
+                    return kinds[from] == VertexKind::Manifold ||
+                           (kinds[from] == VertexKind::Border && isBorderEdge);
+                };
+
+                std::vector<Candidate> candidates;
+                candidates.reserve(edges.size());
+                for (const Edge &edge : edges) {
+                    bool isBorderEdge = edge.Count == 1;
+                    Quadric combined = quadrics[edge.A];
+                    combined.Add(quadrics[edge.B]);
+
+                    Candidate best{0, 0, std::numeric_limits<float>::max()};
+                    if (canMove(edge.A, isBorderEdge)) {
+                        best = Candidate{edge.A, edge.B, combined.Error(positions[edge.B])};
+                    }
+                    if (canMove(edge.B, isBorderEdge)) {
+                        float cost = combined.Error(positions[edge.A]);
+                        if (cost < best.Cost) {
+                            best = Candidate{edge.B, edge.A, cost};
+                        }
+                    }
+                    if (best.Cost != std::numeric_limits<float>::max()) {
+                        candidates.push_back(best);
+                    }
+                }
+
+                std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) {
+                    return a.Cost < b.Cost;
+                });
+
+                // Positions touched this pass stay put until the next one, which keeps the flip
+                // test valid for every collapse that is accepted.
+                std::vector<bool> isTouched(positionCount, false);
+                std::vector<u32> collapseTarget(positionCount, std::numeric_limits<u32>::max());
+                size_t trianglesToRemove = (indices.size() - targetIndexCount + 2) / 3;
+                size_t removed = 0;
+
+                for (const Candidate &candidate : candidates) {
+                    if (removed >= trianglesToRemove) {
+                        break;
+                    }
+                    if (isTouched[candidate.From] || isTouched[candidate.To]) {
+                        continue;
+                    }
+
+                    bool isAccepted = true;
+                    u32 collapsing = 0;
+                    for (u32 i = triangleOffsets[candidate.From];
+                         i < triangleOffsets[candidate.From + 1];
+                         ++i) {
+                        u32 t = adjacency[i];
+                        u32 corners[3] = {positionOf[indices[3 * t]],
+                                          positionOf[indices[3 * t + 1]],
+                                          positionOf[indices[3 * t + 2]]};
+                        if (corners[0] == candidate.To || corners[1] == candidate.To ||
+                            corners[2] == candidate.To) {
+                            ++collapsing;
+                            continue;
+                        }
+                        if (Flips(corners, candidate.From, candidate.To)) {
+                            isAccepted = false;
+                            break;
+                        }
+                    }
+                    if (!isAccepted) {
+                        continue;
+                    }
+
+                    collapseTarget[candidate.From] = candidate.To;
+                    quadrics[candidate.To].Add(quadrics[candidate.From]);
+                    maxError = std::max(maxError, candidate.Cost);
+                    removed += collapsing;
+
+                    // Lock the whole one-ring of the moved position.
+                    for (u32 i = triangleOffsets[candidate.From];
+                         i < triangleOffsets[candidate.From + 1];
+                         ++i) {
+                        u32 t = adjacency[i];
+                        for (u32 k = 0; k < 3; ++k) {
+                            isTouched[positionOf[indices[3 * t + k]]] = true;
+                        }
+                    }
+                }
+
+                if (removed == 0) {
+                    return false;
+                }
+
+                // Rewrite the index buffer and drop the triangles that became degenerate.
+                size_t write = 0;
+                for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                    u32 corners[3];
+                    for (u32 k = 0; k < 3; ++k) {
+                        u32 vertex = indices[i + k];
+                        u32 target = collapseTarget[positionOf[vertex]];
+                        bool isMoved = target != std::numeric_limits<u32>::max();
+                        corners[k] = isMoved ? Wedge(vertex, target) : vertex;
+                    }
+
+                    u32 a = positionOf[corners[0]];
+                    u32 b = positionOf[corners[1]];
+                    u32 c = positionOf[corners[2]];
+                    if (a == b || b == c || a == c) {
+                        continue;
+                    }
+                    indices[write++] = corners[0];
+                    indices[write++] = corners[1];
+                    indices[write++] = corners[2];
+                }
+                indices.resize(write);
+                return true;
+            }
+
+            bool Flips(const u32 (&corners)[3], u32 from, u32 to) const {
+                Vec3 before[3];
+                Vec3 after[3];
+                for (u32 k = 0; k < 3; ++k) {
+                    before[k] = positions[corners[k]];
+                    after[k] = corners[k] == from ? positions[to] : before[k];
+                }
+
+                Vec3 oldNormal = Wrath::Cross(before[1] - before[0], before[2] - before[0]);
+                Vec3 newNormal = Wrath::Cross(after[1] - after[0], after[2] - after[0]);
+                float newLength = Wrath::Length(newNormal);
+
+                // Rounding can make collinear points look like a valid triangle, so slivers are
+                // rejected relative to their longest edge.
+                float longestEdge = std::max({Wrath::Length(after[1] - after[0]),
+                                              Wrath::Length(after[2] - after[1]),
+                                              Wrath::Length(after[0] - after[2])});
+                if (newLength <= MIN_SLIVER_SINE * longestEdge * longestEdge) {
+                    return true;
+                }
+
+                float lengths = Wrath::Length(oldNormal) * newLength;
+                return Wrath::Dot(oldNormal, newNormal) <= MIN_NORMAL_DOT * lengths;
+            }
+
+            // The vertex at position target whose attributes best match vertex.
+            u32 Wedge(u32 vertex, u32 target) const {
+                const Model::Vertex &source = vertices[vertex];
+                u32 best = wedges[wedgeOffsets[target]];
+                float bestDistance = std::numeric_limits<float>::max();
+                for (u32 i = wedgeOffsets[target]; i < wedgeOffsets[target + 1]; ++i) {
+                    const Model::Vertex &candidate = vertices[wedges[i]];
+                    Vec3 normal = candidate.Normal - source.Normal;
+                    Vec3 color = candidate.Color - source.Color;
+                    Vec2 uv = candidate.Uv - source.Uv;
+                    float distance = Wrath::Dot(normal, normal) + Wrath::Dot(color, color) +
+                                     uv.x * uv.x + uv.y * uv.y;
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = wedges[i];
+                    }
+                }
+                return best;
+            }
+
+            const std::vector<Model::Vertex> &vertices;
+            std::vector<u32> indices;
+
+            std::vector<Vec3> positions; // unique positions, normalized to the unit cube
+            std::vector<u32> positionOf; // vertex -> position
+            std::vector<u32> wedgeOffsets;
+            std::vector<u32> wedges; // vertices grouped by position
+            std::vector<Quadric> quadrics;
+            float extent = 1.0f;
+            float maxError = 0.0f;
+        };
+    } // namespace
+
+    void MeshSimplifier::BuildLods(Model::Builder &builder, const ModelLoadOptions &options) {
+        builder.Lods.clear();
+        if (options.LodCount <= 1 || builder.Indices.size() < MIN_LOD_INDEX_COUNT) {
+            return;
+        }
+
+        std::vector<u32> chain = builder.Indices;
+        builder.Lods.push_back(Model::Lod{0, static_cast<u32>(chain.size())});
+
+        QuadricSimplifier simplifier{builder.Vertices, builder.Indices};
+        size_t previousCount = chain.size();
+        for (u32 lod = 1; lod < options.LodCount; ++lod) {
+            size_t target = static_cast<size_t>(previousCount * options.LodReduction) / 3 * 3;
+            if (target < MIN_LOD_INDEX_COUNT) {
+                break;
+            }
+
+            simplifier.Collapse(target);
+            const std::vector<u32> &indices = simplifier.Indices();
+            if (indices.size() > previousCount * (1.0f - MIN_LOD_REDUCTION)) {
+                break;
+            }
+
+            builder.Lods.push_back(Model::Lod{static_cast<u32>(chain.size()),
+                                              static_cast<u32>(indices.size()),
+                                              simplifier.Error()});
+            chain.insert(chain.end(), indices.begin(), indices.end());
+            previousCount = indices.size();
+        }
+
+        builder.Indices = std::move(chain);
+    }
+
+    float MeshSimplifier::Simplify(const std::vector<Model::Vertex> &vertices,
+                                   const std::vector<u32> &indices,
+                                   size_t targetIndexCount,
+                                   std::vector<u32> &result) {
+        QuadricSimplifier simplifier{vertices, indices};
+        simplifier.Collapse(targetIndexCount);
+        result = simplifier.Indices();
+        return simplifier.Error();
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "core.h"
+#include "model.h"
+
+#include <vector>
+
+namespace XIV::Render {
+    // Quadric error edge-collapse simplification. Vertices only ever collapse onto other existing
+    // vertices, so every level of detail indexes into the original vertex buffer.
+    class MeshSimplifier {
+    public:
+        // Levels smaller than this are not worth a draw of their own.
+        static constexpr size_t MIN_LOD_INDEX_COUNT = 36;
+
+        // Appends up to options.LodCount - 1 simplified copies of the mesh to builder.Indices and
+        // describes every level, the original included, in builder.Lods. The chain ends early
+        // once simplification stops making progress.
+        static void BuildLods(Model::Builder &builder, const ModelLoadOptions &options);
+
+        // Collapses edges until at most targetIndexCount indices remain, or no collapse is left
+        // that keeps the surface intact. Returns the error of the result in object space units.
+        static float Simplify(const std::vector<Model::Vertex> &vertices,
+                              const std::vector<u32> &indices,
+                              size_t targetIndexCount,
+                              std::vector<u32> &result);
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
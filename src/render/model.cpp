@@ -1,26 +1,90 @@
 #include "model.h"
-#include "utils.h"
+#include "meshcache.h"
+#include "meshletbuilder.h"
+#include "meshoptimizer.h"
+#include "meshsimplifier.h"
+#include "objreader.h"
+#include "uploadbatch.h"
+#include "vertexwelder.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
 #include <cstring>
-#include <unordered_map>
 
-namespace std {
-    template <> struct hash<XIV::Render::Model::Vertex> {
-        size_t operator()(XIV::Render::Model::Vertex const &vertex) const {
-            size_t seed = 0;
-            XIV::HashCombine(seed, vertex.Position, vertex.Color, vertex.Normal, vertex.Uv);
-            return seed;
+namespace XIV::Render {
+    static_assert(sizeof(Model::CompactVertex) == 20, "CompactVertex must stay tightly packed");
+
+    namespace {
+        i16 QuantizeSnorm16(float value) {
+            value = std::max(-1.0f, std::min(1.0f, value));
+            return static_cast<i16>(std::lround(value * 32767.0f));
         }
-    };
-} // namespace std
 
-namespace XIV::Render {
+        u8 QuantizeUnorm8(float value) {
+            value = std::max(0.0f, std::min(1.0f, value));
+            return static_cast<u8>(std::lround(value * 255.0f));
+        }
+
+        // IEEE 754 binary32 -> binary16, rounding to nearest.
+        u16 FloatToHalf(float value) {
+            u32 bits;
+            memcpy(&bits, &value, sizeof(bits));
+
+            u32 sign = (bits >> 16) & 0x8000u;
+            u32 magnitude = bits & 0x7FFFFFFFu;
+            if (magnitude >= 0x7F800000u) {
+                // Inf stays inf, NaN stays NaN.
+                return static_cast<u16>(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+            }
+
+            i32 exponent = static_cast<i32>(magnitude >> 23) - 127 + 15;
+            u32 mantissa = magnitude & 0x7FFFFFu;
+            if (exponent >= 31) {
+                return static_cast<u16>(sign | 0x7C00u);
+            }
+            if (exponent <= 0) {
+                if (exponent < -10) {
+                    return static_cast<u16>(sign);
+                }
+                mantissa |= 0x800000u;
+                u32 shift = static_cast<u32>(14 - exponent);
+                u32 half = mantissa >> shift;
+                half += (mantissa >> (shift - 1)) & 1u;
+                return static_cast<u16>(sign | half);
+            }
+
+            // A carry out of the mantissa correctly bumps the exponent.
+            u32 half = (static_cast<u32>(exponent) << 10) | (mantissa >> 13);
+            half += (mantissa >> 12) & 1u;
+            return static_cast<u16>(sign | half);
+        }
+
+        // Octahedral mapping of a unit vector onto [-1, 1]^2 (see simple_compact.vert).
+        void EncodeOctahedral(Vec3 normal, i16 out[2]) {
+            float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+            if (length == 0.0f) {
+                out[0] = out[1] = 0;
+                return;
+            }
+
+            float x = normal.x / length;
+            float y = normal.y / length;
+            if (normal.z < 0.0f) {
+                float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = foldedX;
+                y = foldedY;
+            }
+            out[0] = QuantizeSnorm16(x);
+            out[1] = QuantizeSnorm16(y);
+        }
+    } // namespace
+
 #pragma region Vertex Struct Member Functions
     std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions() {
         std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
@@ -42,31 +106,134 @@ namespace XIV::Render {
         return attributeDescriptions;
     }
 
-    std::unique_ptr<Model> Model::CreateModelFromFile(Device &device, const std::string &path) {
-        Builder builder{};
-        builder.LoadModel(path);
-        return std::make_unique<Model>(device, builder);
+    std::vector<VkVertexInputBindingDescription> Model::CompactVertex::GetBindingDescriptions() {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = sizeof(CompactVertex);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription>
+    Model::CompactVertex::GetAttributeDescriptions() {
+        // Only formats with mandatory vertex buffer support; 3-component 16-bit formats are not.
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+        attributeDescriptions.push_back(
+            {0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(CompactVertex, Position)});
+        attributeDescriptions.push_back(
+            {1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex, Color)});
+        attributeDescriptions.push_back(
+            {2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, Normal)});
+        attributeDescriptions.push_back(
+            {3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, Uv)});
+        return attributeDescriptions;
+    }
+
+    std::unique_ptr<Model> Model::CreateModelFromFile(Device &device,
+                                                      const std::string &path,
+                                                      const ModelLoadOptions &options) {
+        return std::make_unique<Model>(device, LoadMesh(path, options));
+    }
+
+    Model::MeshView Model::LoadMesh(const std::string &path, const ModelLoadOptions &options) {
+        // Fast path: a valid binary cache is uploaded straight from its mapping.
+        auto cache = std::make_shared<MeshCache>(RESOURCE_DIR + path, options.CacheKey());
+        if (cache->Load()) {
+            MeshView mesh = cache->Mesh;
+            mesh.Owner = cache;
+            return mesh;
+        }
+
+        auto builder = std::make_shared<Builder>();
+        builder->LoadModel(path);
+        MeshSimplifier::BuildLods(*builder, options);
+        if (options.BuildMeshlets) {
+            MeshletBuilder::Build(*builder);
+        }
+        MeshOptimizer::Optimize(*builder, options);
+        builder->Encode(options.Format);
+        cache->Store(builder->View());
+
+        MeshView mesh = builder->View();
+        mesh.Owner = builder;
+        return mesh;
     }
 #pragma endregion
 
 #pragma region Builder Struct Member Functions
 
     void Model::Builder::LoadModel(const std::string &path) {
+        LoadObjFile(RESOURCE_DIR + path);
+    }
+
+    void Model::Builder::LoadObjFile(const std::string &filePath) {
+        ObjData data{};
+        ObjReader::Read(filePath, data);
+
+        auto makeVertex = [&data](const ObjData::Index &index) {
+            Vertex vertex{};
+
+            if (index.Position >= 0) {
+                const float *position = &data.Positions[3 * static_cast<size_t>(index.Position)];
+                const float *color = &data.Colors[3 * static_cast<size_t>(index.Position)];
+                vertex.Position = {position[0], position[1], position[2]};
+                vertex.Color = {color[0], color[1], color[2]};
+            }
+
+            if (index.Normal >= 0) {
+                const float *normal = &data.Normals[3 * static_cast<size_t>(index.Normal)];
+                vertex.Normal = {normal[0], normal[1], normal[2]};
+            }
+
+            if (index.Texcoord >= 0) {
+                const float *uv = &data.Texcoords[2 * static_cast<size_t>(index.Texcoord)];
+                vertex.Uv = {uv[0], uv[1]};
+            }
+            return vertex;
+        };
+
+        Vertices.clear();
+        Indices.clear();
+
+        ThreadPool &pool = ThreadPool::Shared();
+        size_t cornerCount = data.Indices.size();
+
+        if (cornerCount >= VertexWelder::PARALLEL_THRESHOLD && pool.ThreadCount() > 0) {
+            std::vector<Vertex> corners(cornerCount);
+            u32 chunkCount = (pool.ThreadCount() + 1) * 4;
+            size_t chunkSize = (cornerCount + chunkCount - 1) / chunkCount;
+            pool.ParallelFor(chunkCount, [&](u32 chunk) {
+                size_t end = std::min(cornerCount, (chunk + 1) * chunkSize);
+                for (size_t i = chunk * chunkSize; i < end; ++i) {
+                    corners[i] = makeVertex(data.Indices[i]);
+                }
+            });
+
+            VertexWelder::WeldParallel(corners.data(), cornerCount, Vertices, Indices, pool);
+            return;
+        }
+
+        Indices.reserve(cornerCount);
+        VertexWelder welder{Vertices, cornerCount / 4};
+        for (const auto &index : data.Indices) {
+            Indices.push_back(welder.Weld(makeVertex(index)));
+        }
+    }
+
+    void Model::Builder::LoadObjFileTinyObj(const std::string &filePath) {
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
         std::vector<tinyobj::material_t> materials;
         std::string warn, err;
 
-        std::string finalPath = RESOURCE_DIR + path;
-
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, finalPath.c_str())) {
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.c_str())) {
             throw std::runtime_error(warn + err);
         }
 
         Vertices.clear();
         Indices.clear();
 
-        std::unordered_map<Vertex, u32> uniqueVertices{};
+        VertexWelder welder{Vertices};
         for (const auto &shape : shapes) {
             for (const auto &index : shape.mesh.indices) {
                 Vertex vertex{};
@@ -100,97 +267,315 @@ namespace XIV::Render {
                     };
                 }
 
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(Vertices.size());
-                    Vertices.push_back(vertex);
-                }
-                Indices.push_back(uniqueVertices[vertex]);
+                Indices.push_back(welder.Weld(vertex));
+            }
+        }
+    }
+
+    void Model::Builder::Encode(VertexFormat format) {
+        Format = format;
+        CompactVertices.clear();
+        ShortIndices.clear();
+        QuantizationOffset = Vec3{0.0f};
+        QuantizationScale = Vec3{1.0f};
+
+        if (Vertices.size() < 65536) {
+            ShortIndices.assign(Indices.begin(), Indices.end());
+        }
+
+        if (format != VertexFormat::Compact || Vertices.empty()) {
+            Format = VertexFormat::Full;
+            return;
+        }
+
+        // Quantize positions against the mesh bounds, one scale per axis.
+        Vec3 minimum = Vertices[0].Position;
+        Vec3 maximum = Vertices[0].Position;
+        for (const Vertex &vertex : Vertices) {
+            for (int axis = 0; axis < 3; ++axis) {
+                minimum[axis] = std::min(minimum[axis], vertex.Position[axis]);
+                maximum[axis] = std::max(maximum[axis], vertex.Position[axis]);
             }
         }
+
+        for (int axis = 0; axis < 3; ++axis) {
+            float extent = 0.5f * (maximum[axis] - minimum[axis]);
+            QuantizationOffset[axis] = 0.5f * (maximum[axis] + minimum[axis]);
+            QuantizationScale[axis] = extent > 0.0f ? extent : 1.0f;
+        }
+
+        CompactVertices.resize(Vertices.size());
+        for (size_t i = 0; i < Vertices.size(); ++i) {
+            const Vertex &vertex = Vertices[i];
+            CompactVertex &compact = CompactVertices[i];
+
+            for (int axis = 0; axis < 3; ++axis) {
+                compact.Position[axis] = QuantizeSnorm16(
+                    (vertex.Position[axis] - QuantizationOffset[axis]) / QuantizationScale[axis]);
+            }
+            compact.Position[3] = 0;
+
+            EncodeOctahedral(vertex.Normal, compact.Normal);
+
+            compact.Color[0] = QuantizeUnorm8(vertex.Color.x);
+            compact.Color[1] = QuantizeUnorm8(vertex.Color.y);
+            compact.Color[2] = QuantizeUnorm8(vertex.Color.z);
+            compact.Color[3] = 255;
+
+            compact.Uv[0] = FloatToHalf(vertex.Uv.x);
+            compact.Uv[1] = FloatToHalf(vertex.Uv.y);
+        }
+    }
+
+    Model::MeshView Model::Builder::View() const {
+        MeshView view{};
+        view.Format = Format;
+        view.QuantizationOffset = QuantizationOffset;
+        view.QuantizationScale = QuantizationScale;
+        view.Lods = Lods.data();
+        view.LodCount = static_cast<u32>(Lods.size());
+        view.Meshlets = Meshlets.data();
+        view.MeshletCount = static_cast<u32>(Meshlets.size());
+
+        if (Format == VertexFormat::Compact) {
+            view.Vertices = CompactVertices.data();
+            view.VertexCount = static_cast<u32>(CompactVertices.size());
+        } else {
+            view.Vertices = Vertices.data();
+            view.VertexCount = static_cast<u32>(Vertices.size());
+        }
+
+        if (!ShortIndices.empty()) {
+            view.Indices = ShortIndices.data();
+            view.IndexCount = static_cast<u32>(ShortIndices.size());
+            view.IndexSize = sizeof(u16);
+        } else {
+            view.Indices = Indices.data();
+            view.IndexCount = static_cast<u32>(Indices.size());
+            view.IndexSize = sizeof(u32);
+        }
+        return view;
     }
 
 #pragma endregion
 
 #pragma region Model Class Member Functions
-    Model::Model(Device &device, const Model::Builder &builder) : device(device) {
-        CreateVertexBuffers(builder.Vertices);
-        CreateIndexBuffers(builder.Indices);
+    Model::Model(Device &device, const Model::Builder &builder) : Model(device, builder.View()) {}
+
+    Model::Model(Device &device,
+                 const Model::MeshView &mesh,
+                 UploadBatch *batch,
+                 GeometryPool *pool)
+        : device(device), format{mesh.Format}, geometryPool{pool} {
+        dequantizationMatrix[0][0] = mesh.QuantizationScale.x;
+        dequantizationMatrix[1][1] = mesh.QuantizationScale.y;
+        dequantizationMatrix[2][2] = mesh.QuantizationScale.z;
+        dequantizationMatrix[3][0] = mesh.QuantizationOffset.x;
+        dequantizationMatrix[3][1] = mesh.QuantizationOffset.y;
+        dequantizationMatrix[3][2] = mesh.QuantizationOffset.z;
+
+        lods.assign(mesh.Lods, mesh.Lods + mesh.LodCount);
+        if (lods.empty()) {
+            lods.push_back(Lod{0, mesh.IndexCount, 0.0f, 0, mesh.MeshletCount});
+        }
+        meshlets.assign(mesh.Meshlets, mesh.Meshlets + mesh.MeshletCount);
+        ComputeBounds(mesh);
+
+        auto createBuffers = [&](UploadBatch &uploadBatch) {
+            if (geometryPool != nullptr) {
+                CreatePooledBuffers(mesh, uploadBatch);
+                return;
+            }
+            CreateVertexBuffers(mesh.Vertices, mesh.VertexStride(), mesh.VertexCount, uploadBatch);
+            CreateIndexBuffers(mesh.Indices, mesh.IndexSize, mesh.IndexCount, uploadBatch);
+            vertexBufferHandle = vertexBuffer->VulkanBuffer;
+            indexBufferHandle = hasIndexBuffer ? indexBuffer->VulkanBuffer : VK_NULL_HANDLE;
+        };
+
+        if (batch != nullptr) {
+            createBuffers(*batch);
+            return;
+        }
+
+        // Both buffers share one submission and one fence wait.
+        UploadBatch localBatch{device};
+        createBuffers(localBatch);
+        localBatch.Submit();
+        localBatch.Wait();
     }
 
-    Model::~Model() {}
+    Model::~Model() {
+        if (geometryPool != nullptr) {
+            // The ranges must not be handed to another mesh while frames still draw this one.
+            GeometryPool *pool = geometryPool;
+            pool->ClearRelocatable(allocation.Id);
+            device.GetDeletionQueue().Enqueue(
+                [pool, allocation = allocation]() { pool->Free(allocation); });
+        }
+    }
+
+    VkDeviceSize Model::MemoryBytes() const {
+        if (geometryPool != nullptr) {
+            return allocation.Bytes();
+        }
+
+        VkDeviceSize bytes = vertexBuffer->BufferSize;
+        if (hasIndexBuffer) {
+            bytes += indexBuffer->BufferSize;
+        }
+        return bytes;
+    }
+
+    void Model::EnableRelocation() {
+        if (geometryPool == nullptr) {
+            return;
+        }
+
+        geometryPool->SetRelocatable(allocation, [this](const GeometryPool::Allocation &moved) {
+            allocation = moved;
+            vertexBufferHandle = allocation.VertexBuffer;
+            indexBufferHandle = allocation.IndexBuffer;
+            baseVertex = static_cast<i32>(allocation.VertexOffset);
+            baseIndex = allocation.FirstIndex;
+        });
+    }
 
     void Model::Bind(VkCommandBuffer commandBuffer) {
-        VkBuffer buffers[] = {vertexBuffer->VulkanBuffer};
+        VkBuffer buffers[] = {vertexBufferHandle};
         VkDeviceSize offsets[] = {0};
         vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
         if (hasIndexBuffer) {
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->VulkanBuffer, 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindIndexBuffer(commandBuffer, indexBufferHandle, 0, indexType);
         }
     }
 
-    void Model::Draw(VkCommandBuffer commandBuffer) {
+    void Model::Draw(VkCommandBuffer commandBuffer, u32 lod) {
         if (hasIndexBuffer) {
-            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+            const Lod &range = lods[std::min(lod, LodCount() - 1)];
+            vkCmdDrawIndexed(
+                commandBuffer, range.IndexCount, 1, baseIndex + range.FirstIndex, baseVertex, 0);
         } else {
-            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+            vkCmdDraw(commandBuffer, vertexCount, 1, static_cast<u32>(baseVertex), 0);
         }
     }
 
-    void Model::CreateVertexBuffers(const std::vector<Vertex> &vertices) {
-        vertexCount = static_cast<uint32_t>(vertices.size());
+    void Model::DrawRange(VkCommandBuffer commandBuffer, u32 firstIndex, u32 indexCount) {
+        vkCmdDrawIndexed(commandBuffer, indexCount, 1, baseIndex + firstIndex, baseVertex, 0);
+    }
+
+    void Model::ComputeBounds(const MeshView &mesh) {
+        if (mesh.VertexCount == 0) {
+            return;
+        }
+
+        const u8 *data = static_cast<const u8 *>(mesh.Vertices);
+        u32 stride = mesh.VertexStride();
+        auto positionAt = [&](u32 i) {
+            const u8 *vertex = data + static_cast<size_t>(i) * stride;
+            if (mesh.Format == VertexFormat::Compact) {
+                i16 position[4];
+                memcpy(position, vertex + offsetof(CompactVertex, Position), sizeof(position));
+                Vec3 normalized{position[0] / 32767.0f,
+                                position[1] / 32767.0f,
+                                position[2] / 32767.0f};
+                return mesh.QuantizationOffset + mesh.QuantizationScale * normalized;
+            }
+            Vec3 position;
+            memcpy(&position, vertex + offsetof(Vertex, Position), sizeof(position));
+            return position;
+        };
+
+        Vec3 minimum = positionAt(0);
+        Vec3 maximum = minimum;
+        for (u32 i = 1; i < mesh.VertexCount; ++i) {
+            Vec3 position = positionAt(i);
+            for (int axis = 0; axis < 3; ++axis) {
+                minimum[axis] = std::min(minimum[axis], position[axis]);
+                maximum[axis] = std::max(maximum[axis], position[axis]);
+            }
+        }
+
+        boundsCenter = 0.5f * (minimum + maximum);
+        boundsRadius = 0.0f;
+        for (u32 i = 0; i < mesh.VertexCount; ++i) {
+            boundsRadius = std::max(boundsRadius, Wrath::Length(positionAt(i) - boundsCenter));
+        }
+    }
+
+    void Model::CreateVertexBuffers(const void *vertices,
+                                    u32 stride,
+                                    u32 count,
+                                    UploadBatch &batch) {
+        vertexCount = count;
         assert(vertexCount >= 3 && "Vertex count must be at least 3.");
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-        u32 vertexSize = sizeof(vertices[0]);
-
-        Buffer stagingBuffer{device,
-                             vertexSize,
-                             vertexCount,
-                             VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
-        stagingBuffer.Map();
-        stagingBuffer.WriteToBuffer((void *)vertices.data());
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(stride) * vertexCount;
+        u32 vertexSize = stride;
 
         vertexBuffer = std::make_unique<Buffer>(device,
                                                 vertexSize,
                                                 vertexCount,
                                                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
                                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                                                MemoryUsage::GpuOnly);
 
-        device.CopyBuffer(stagingBuffer.VulkanBuffer, vertexBuffer->VulkanBuffer, bufferSize);
+        batch.WriteToBuffer(vertices, bufferSize, *vertexBuffer);
     }
 
-    void Model::CreateIndexBuffers(const std::vector<u32> &indices) {
-        indexCount = static_cast<u32>(indices.size());
+    void Model::CreateIndexBuffers(const void *indices,
+                                   u32 indexSize,
+                                   u32 count,
+                                   UploadBatch &batch) {
+        indexCount = count;
         hasIndexBuffer = indexCount > 0;
+        indexType = indexSize == sizeof(u16) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 
         if (!hasIndexBuffer) {
             return;
         }
 
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-        u32 indexSize = sizeof(indices[0]);
-
-        Buffer stagingBuffer{
-            device,
-            indexSize,
-            indexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
-
-        stagingBuffer.Map();
-        stagingBuffer.WriteToBuffer((void *)indices.data());
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize) * indexCount;
 
         indexBuffer = std::make_unique<Buffer>(device,
                                                indexSize,
                                                indexCount,
                                                VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
                                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        device.CopyBuffer(stagingBuffer.VulkanBuffer, indexBuffer->VulkanBuffer, bufferSize);
+                                               MemoryUsage::GpuOnly);
+
+        batch.WriteToBuffer(indices, bufferSize, *indexBuffer);
+    }
+
+    void Model::CreatePooledBuffers(const MeshView &mesh, UploadBatch &batch) {
+        vertexCount = mesh.VertexCount;
+        assert(vertexCount >= 3 && "Vertex count must be at least 3.");
+        indexCount = mesh.IndexCount;
+        hasIndexBuffer = indexCount > 0;
+        indexType = mesh.IndexSize == sizeof(u16) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+        u32 stride = mesh.VertexStride();
+        allocation = geometryPool->Allocate(stride, vertexCount, mesh.IndexSize, indexCount);
+        vertexBufferHandle = allocation.VertexBuffer;
+        indexBufferHandle = allocation.IndexBuffer;
+        baseVertex = static_cast<i32>(allocation.VertexOffset);
+        baseIndex = allocation.FirstIndex;
+
+        // The destructor will not run if this throws, so hand the ranges back here.
+        try {
+            batch.WriteToBuffer(mesh.Vertices,
+                                static_cast<VkDeviceSize>(stride) * vertexCount,
+                                *allocation.VertexStorage,
+                                static_cast<VkDeviceSize>(stride) * allocation.VertexOffset);
+            if (hasIndexBuffer) {
+                batch.WriteToBuffer(mesh.Indices,
+                                    static_cast<VkDeviceSize>(mesh.IndexSize) * indexCount,
+                                    *allocation.IndexStorage,
+                                    static_cast<VkDeviceSize>(mesh.IndexSize) * baseIndex);
+            }
+        } catch (...) {
+            geometryPool->Free(allocation);
+            throw;
+        }
     }
 #pragma endregion
 } // namespace XIV
\ No newline at end of file
@@ -3,12 +3,53 @@
 
 #include "buffer.h"
 #include "device.h"
+#include "geometrypool.h"
+#include "utils.h"
 #include "wrath.h"
 
 #include <memory>
 #include <vector>
 
 namespace XIV::Render {
+    class UploadBatch;
+
+    // Layout of a model's vertex buffer. Full is 44 bytes of floats; Compact is 20 bytes with
+    // quantized positions, octahedral normals, 8-bit color and half-float uvs.
+    enum class VertexFormat : u32 {
+        Full = 0,
+        Compact = 1,
+    };
+
+    // Processing applied to a mesh between parsing and upload. Part of the mesh cache key, so
+    // changing any of these rebuilds the cache.
+    struct ModelLoadOptions {
+        bool OptimizeVertexCache = true;
+        bool OptimizeOverdraw = false;
+        float OverdrawThreshold = 1.05f; // max ACMR growth allowed for overdraw ordering
+        bool OptimizeVertexFetch = true;
+        VertexFormat Format = VertexFormat::Full;
+        u32 LodCount = 1;          // levels of detail to generate, including the full mesh
+        float LodReduction = 0.5f; // triangle ratio between consecutive levels
+        bool BuildMeshlets = false;
+
+        u64 CacheKey() const {
+            // Every field is 4 bytes, so there is no padding to hash.
+            struct {
+                u32 Flags;
+                u32 Format;
+                u32 LodCount;
+                float OverdrawThreshold;
+                float LodReduction;
+            } fields{(OptimizeVertexCache ? 1u : 0u) | (OptimizeOverdraw ? 2u : 0u) |
+                         (OptimizeVertexFetch ? 4u : 0u) | (BuildMeshlets ? 8u : 0u),
+                     static_cast<u32>(Format),
+                     LodCount,
+                     OverdrawThreshold,
+                     LodReduction};
+            return HashBytes(&fields, sizeof(fields));
+        }
+    };
+
     class Model {
     public:
         static inline const char *ENGINE_DIR = "../../";
@@ -27,33 +68,190 @@ namespace XIV::Render {
             }
         };
 
+        struct CompactVertex {
+            i16 Position[4]; // snorm16, dequantized by the model's DequantizationMatrix
+            i16 Normal[2];   // octahedral snorm16
+            u8 Color[4];     // unorm8, alpha unused
+            u16 Uv[2];       // half float
+            static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+        };
+
+        // A level of detail: a range of the shared index buffer. Error is the largest deviation
+        // from the full mesh, in object space units.
+        struct Lod {
+            u32 FirstIndex = 0;
+            u32 IndexCount = 0;
+            float Error = 0.0f;
+            u32 FirstMeshlet = 0;
+            u32 MeshletCount = 0;
+        };
+
+        // A small cluster of triangles, stored as a contiguous index range so it can be culled
+        // and drawn on its own. Bounds are in object space.
+        struct Meshlet {
+            u32 FirstIndex = 0;
+            u32 IndexCount = 0;
+            Vec3 Center{0.0f};
+            float Radius = 0.0f;
+            // Every triangle faces away from a viewer at p when
+            // dot(Center - p, ConeAxis) >= ConeCutoff * length(Center - p) + Radius.
+            Vec3 ConeAxis{0.0f};
+            float ConeCutoff = 1.0f; // 1 never culls
+        };
+
+        // View of final mesh data, either from a Builder or a mapped MeshCache. When Owner is set
+        // it keeps that data alive, so the view can be handed between threads on its own.
+        struct MeshView {
+            VertexFormat Format = VertexFormat::Full;
+            const void *Vertices = nullptr;
+            u32 VertexCount = 0;
+            const void *Indices = nullptr;
+            u32 IndexCount = 0;
+            u32 IndexSize = sizeof(u32);
+            // Compact positions decode as Offset + Scale * position.
+            Vec3 QuantizationOffset{0.0f};
+            Vec3 QuantizationScale{1.0f};
+            // Levels of detail, finest first. Empty means one level covering every index.
+            const Lod *Lods = nullptr;
+            u32 LodCount = 0;
+            const Meshlet *Meshlets = nullptr;
+            u32 MeshletCount = 0;
+            std::shared_ptr<const void> Owner{};
+
+            u32 VertexStride() const {
+                return Format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+            }
+        };
+
         struct Builder {
             std::vector<Vertex> Vertices{};
             std::vector<u32> Indices{};
+            std::vector<Lod> Lods{};
+            std::vector<Meshlet> Meshlets{};
+
+            // Filled by Encode; when present, View() hands these out instead.
+            VertexFormat Format = VertexFormat::Full;
+            std::vector<CompactVertex> CompactVertices{};
+            std::vector<u16> ShortIndices{};
+            Vec3 QuantizationOffset{0.0f};
+            Vec3 QuantizationScale{1.0f};
+
+            // Loads an OBJ from the resource directory.
             void LoadModel(const std::string &path);
+            // Loads an OBJ from any path with the multi-threaded ObjReader.
+            void LoadObjFile(const std::string &filePath);
+            // Single-threaded tinyobjloader path, kept as a reference for the mesh benchmark.
+            void LoadObjFileTinyObj(const std::string &filePath);
+            // Produces the upload encoding: the requested vertex format, and 16-bit indices
+            // whenever every vertex is addressable with them.
+            void Encode(VertexFormat format);
+            MeshView View() const;
         };
 
         Model(Device &device, const Model::Builder &builder);
+        // With a batch, the copies are only recorded and the model must not be drawn until the
+        // batch completes; without one, the upload finishes before the constructor returns.
+        // With a pool, the mesh is suballocated from it instead of getting buffers of its own.
+        Model(Device &device,
+              const Model::MeshView &mesh,
+              UploadBatch *batch = nullptr,
+              GeometryPool *pool = nullptr);
         ~Model();
         Model(const Model &) = delete;
         Model &operator=(const Model &) = delete;
 
-        static std::unique_ptr<Model> CreateModelFromFile(Device &device, const std::string &path);
+        static std::unique_ptr<Model> CreateModelFromFile(Device &device,
+                                                          const std::string &path,
+                                                          const ModelLoadOptions &options = {});
+        // The CPU half of CreateModelFromFile: maps the mesh cache, or parses, optimizes, encodes
+        // and caches the source file. Touches no Vulkan state, so it is safe on any thread.
+        static MeshView LoadMesh(const std::string &path, const ModelLoadOptions &options = {});
 
         void Bind(VkCommandBuffer commandBuffer);
-        void Draw(VkCommandBuffer commandBuffer);
+        // The buffers Bind binds. Pooled models share them, so a bind can be skipped whenever
+        // they match the previous model's.
+        VkBuffer VertexBuffer() const {
+            return vertexBufferHandle;
+        }
+
+        VkBuffer IndexBuffer() const {
+            return indexBufferHandle;
+        }
+
+        void Draw(VkCommandBuffer commandBuffer, u32 lod = 0);
+        // Draws part of the index buffer, e.g. a run of visible meshlets.
+        void DrawRange(VkCommandBuffer commandBuffer, u32 firstIndex, u32 indexCount);
+
+        u32 LodCount() const {
+            return static_cast<u32>(lods.size());
+        }
+
+        const Lod &GetLod(u32 lod) const {
+            return lods[lod];
+        }
+
+        // Empty unless the model was loaded with BuildMeshlets; each Lod names its own range.
+        const std::vector<Meshlet> &Meshlets() const {
+            return meshlets;
+        }
+
+        // Object-space bounding sphere.
+        const Vec3 &BoundsCenter() const {
+            return boundsCenter;
+        }
+
+        float BoundsRadius() const {
+            return boundsRadius;
+        }
+
+        VertexFormat Format() const {
+            return format;
+        }
+
+        // Device memory used by the vertex and index buffers, or by the model's pool ranges.
+        VkDeviceSize MemoryBytes() const;
+
+        // Lets GeometryPool::Defragment move a pooled model's ranges; no-op for unpooled ones.
+        // Only call once the upload has completed. Bind and Draw pick up the new location, so
+        // the model must be drawn from the thread that defragments.
+        void EnableRelocation();
+
+        // Maps stored positions back to object space; identity for full-precision models.
+        const Mat4 &DequantizationMatrix() const {
+            return dequantizationMatrix;
+        }
 
     private:
-        void CreateVertexBuffers(const std::vector<Vertex> &vertices);
-        void CreateIndexBuffers(const std::vector<u32> &indices);
+        void ComputeBounds(const MeshView &mesh);
+        void
+        CreateVertexBuffers(const void *vertices, u32 stride, u32 count, UploadBatch &batch);
+        void CreateIndexBuffers(const void *indices, u32 indexSize, u32 count, UploadBatch &batch);
+        void CreatePooledBuffers(const MeshView &mesh, UploadBatch &batch);
 
         Device &device;
+        VertexFormat format = VertexFormat::Full;
+        Mat4 dequantizationMatrix{1.0f};
+        std::vector<Lod> lods{};
+        std::vector<Meshlet> meshlets{};
+        Vec3 boundsCenter{0.0f};
+        float boundsRadius = 0.0f;
+
         std::unique_ptr<Buffer> vertexBuffer;
         u32 vertexCount;
 
         bool hasIndexBuffer = false;
         std::unique_ptr<Buffer> indexBuffer;
         u32 indexCount;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+        GeometryPool *geometryPool = nullptr;
+        GeometryPool::Allocation allocation{};
+        VkBuffer vertexBufferHandle = VK_NULL_HANDLE;
+        VkBuffer indexBufferHandle = VK_NULL_HANDLE;
+        // Where the model's data starts within those buffers; zero unless pooled.
+        i32 baseVertex = 0;
+        u32 baseIndex = 0;
     };
 } // namespace XIV::Render
 
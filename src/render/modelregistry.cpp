@@ -0,0 +1,180 @@
+#include "modelregistry.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+namespace XIV::Render {
+    ModelRegistry::ModelRegistry(Device &device,
+                                 GeometryPool *geometryPool,
+                                 VkDeviceSize budgetBytes)
+        : device{device}, geometryPool{geometryPool}, budgetBytes{budgetBytes} {}
+
+    ModelRegistry::~ModelRegistry() {}
+
+    std::shared_ptr<Model> ModelRegistry::Load(const std::string &path,
+                                               const ModelLoadOptions &options) {
+        std::string key = MakeKey(path, options);
+
+        std::unique_lock<std::mutex> lock{mutex};
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            ++hits;
+            it->second.LastUsed = ++useCounter;
+            std::shared_future<std::shared_ptr<Model>> model = it->second.Model;
+
+            // Another thread may still be loading it; wait without holding the lock.
+            lock.unlock();
+            return model.get();
+        }
+
+        ++misses;
+        std::promise<std::shared_ptr<Model>> promise;
+        Entry &entry = entries[key];
+        entry.Model = promise.get_future().share();
+        entry.LastUsed = ++useCounter;
+        lock.unlock();
+
+        std::shared_ptr<Model> model;
+        try {
+            Model::MeshView mesh = Model::LoadMesh(path, options);
+            model = std::make_shared<Model>(device, mesh, nullptr, geometryPool);
+            model->EnableRelocation();
+        } catch (...) {
+            // Forget the failed load so a later request can retry, and wake any waiters.
+            lock.lock();
+            entries.erase(key);
+            lock.unlock();
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        lock.lock();
+        Entry &loaded = entries[key];
+        loaded.Bytes = model->MemoryBytes();
+        loaded.IsReady = true;
+        residentBytes += loaded.Bytes;
+        promise.set_value(model);
+
+        EvictLocked(budgetBytes);
+        return model;
+    }
+
+    std::shared_ptr<Model> ModelRegistry::Find(const std::string &path,
+                                               const ModelLoadOptions &options) {
+        std::string key = MakeKey(path, options);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = entries.find(key);
+        if (it == entries.end() || !it->second.IsReady) {
+            return nullptr;
+        }
+
+        ++hits;
+        it->second.LastUsed = ++useCounter;
+        return it->second.Model.get();
+    }
+
+    std::shared_ptr<Model> ModelRegistry::Adopt(const std::string &path,
+                                                const ModelLoadOptions &options,
+                                                std::shared_ptr<Model> model) {
+        std::string key = MakeKey(path, options);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            // A load still in flight keeps its own entry; the caller keeps its copy.
+            if (!it->second.IsReady) {
+                return model;
+            }
+            it->second.LastUsed = ++useCounter;
+            return it->second.Model.get();
+        }
+
+        std::promise<std::shared_ptr<Model>> promise;
+        promise.set_value(model);
+
+        Entry &entry = entries[key];
+        entry.Model = promise.get_future().share();
+        entry.Bytes = model->MemoryBytes();
+        entry.LastUsed = ++useCounter;
+        entry.IsReady = true;
+        residentBytes += entry.Bytes;
+
+        EvictLocked(budgetBytes);
+        return model;
+    }
+
+    void ModelRegistry::SetBudget(VkDeviceSize budgetBytes) {
+        std::lock_guard<std::mutex> lock{mutex};
+        this->budgetBytes = budgetBytes;
+        EvictLocked(budgetBytes);
+    }
+
+    void ModelRegistry::Trim() {
+        std::lock_guard<std::mutex> lock{mutex};
+        EvictLocked(budgetBytes);
+    }
+
+    void ModelRegistry::Purge() {
+        std::lock_guard<std::mutex> lock{mutex};
+        EvictLocked(0);
+    }
+
+    ModelRegistry::Stats ModelRegistry::GetStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        Stats stats{};
+        stats.ModelCount = entries.size();
+        stats.ResidentBytes = residentBytes;
+        stats.BudgetBytes = budgetBytes;
+        stats.Hits = hits;
+        stats.Misses = misses;
+        stats.Evictions = evictions;
+        for (const auto &kv : entries) {
+            if (!kv.second.IsReady || kv.second.Model.get().use_count() > 1) {
+                ++stats.ReferencedCount;
+            }
+        }
+        return stats;
+    }
+
+    std::string ModelRegistry::MakeKey(const std::string &path, const ModelLoadOptions &options) {
+        // Canonicalize so "models/a.obj" and "models/../models/a.obj" share one entry.
+        std::error_code error;
+        std::filesystem::path fullPath = std::string(Model::RESOURCE_DIR) + path;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(fullPath, error);
+        std::string key = error ? fullPath.lexically_normal().string() : canonical.string();
+        return key + "|" + std::to_string(options.CacheKey());
+    }
+
+    void ModelRegistry::EvictLocked(VkDeviceSize targetBytes) {
+        if (residentBytes <= targetBytes) {
+            return;
+        }
+
+        // The shared_future holds one reference itself, so a use count of one means only the
+        // registry still knows about the model.
+        std::vector<std::unordered_map<std::string, Entry>::iterator> candidates;
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->second.IsReady && it->second.Model.get().use_count() == 1) {
+                candidates.push_back(it);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) {
+            return a->second.LastUsed < b->second.LastUsed;
+        });
+
+        // Frames in flight may still draw an evicted model; its buffers and pool ranges go
+        // through the device's DeletionQueue, so dropping it here is safe.
+        for (auto &it : candidates) {
+            if (residentBytes <= targetBytes) {
+                break;
+            }
+            residentBytes -= it->second.Bytes;
+            entries.erase(it);
+            ++evictions;
+        }
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef MODEL_REGISTRY_H
+#define MODEL_REGISTRY_H
+
+#include "core.h"
+#include "device.h"
+#include "geometrypool.h"
+#include "model.h"
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace XIV::Render {
+    // Shares one Model per (file, load options) between everything that asks for it.
+    // Models nobody else holds stay resident until the registry goes over its memory budget, at
+    // which point they are evicted least recently requested first.
+    class ModelRegistry {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BUDGET = 256ull * 1024 * 1024;
+
+        struct Stats {
+            size_t ModelCount = 0;
+            size_t ReferencedCount = 0;
+            VkDeviceSize ResidentBytes = 0;
+            VkDeviceSize BudgetBytes = 0;
+            u64 Hits = 0;
+            u64 Misses = 0;
+            u64 Evictions = 0;
+        };
+
+        // With a geometry pool, loaded models are suballocated from it.
+        ModelRegistry(Device &device,
+                      GeometryPool *geometryPool = nullptr,
+                      VkDeviceSize budgetBytes = DEFAULT_BUDGET);
+        ~ModelRegistry();
+        ModelRegistry(const ModelRegistry &) = delete;
+        ModelRegistry &operator=(const ModelRegistry &) = delete;
+
+        // Returns the shared model for path, loading it on first use. Safe to call from several
+        // threads: concurrent requests for the same model wait for a single load.
+        std::shared_ptr<Model> Load(const std::string &path, const ModelLoadOptions &options = {});
+        // Returns the model if it is already resident, without loading or waiting.
+        std::shared_ptr<Model> Find(const std::string &path, const ModelLoadOptions &options = {});
+        // Registers a model that was uploaded elsewhere, such as by the ModelStreamer. If the
+        // registry already holds one for the same key, that one is returned instead.
+        std::shared_ptr<Model> Adopt(const std::string &path,
+                                     const ModelLoadOptions &options,
+                                     std::shared_ptr<Model> model);
+
+        void SetBudget(VkDeviceSize budgetBytes);
+
+        // Identifies a model by its file and the options that change its contents.
+        static std::string MakeKey(const std::string &path, const ModelLoadOptions &options);
+        // Evicts unreferenced models, oldest first, until resident memory fits the budget.
+        void Trim();
+        // Evicts every unreferenced model regardless of budget.
+        void Purge();
+
+        Stats GetStats() const;
+
+    private:
+        struct Entry {
+            std::shared_future<std::shared_ptr<Model>> Model{};
+            VkDeviceSize Bytes = 0;
+            u64 LastUsed = 0;
+            bool IsReady = false;
+        };
+
+        void EvictLocked(VkDeviceSize targetBytes);
+
+        Device &device;
+        GeometryPool *geometryPool;
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        VkDeviceSize budgetBytes;
+        VkDeviceSize residentBytes = 0;
+        u64 useCounter = 0;
+        u64 hits = 0;
+        u64 misses = 0;
+        u64 evictions = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
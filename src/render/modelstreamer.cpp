@@ -0,0 +1,183 @@
+#include "modelstreamer.h"
+
+#include <iostream>
+
+namespace XIV::Render {
+    ModelStreamer::ModelStreamer(Device &device,
+                                 ModelRegistry *registry,
+                                 GeometryPool *geometryPool,
+                                 ThreadPool &pool)
+        : device{device}, registry{registry}, geometryPool{geometryPool}, pool{pool} {}
+
+    ModelStreamer::~ModelStreamer() {
+        // Parse jobs point back at this streamer, so they have to drain first.
+        std::unique_lock<std::mutex> lock{mutex};
+        parsingDone.wait(lock, [this]() { return parsingCount == 0; });
+        lock.unlock();
+
+        // Models in flight must outlive the copies into their buffers.
+        for (auto &batch : inFlight) {
+            batch.Upload->Wait();
+        }
+    }
+
+    std::shared_future<std::shared_ptr<Model>>
+    ModelStreamer::LoadAsync(const std::string &path,
+                             const ModelLoadOptions &options,
+                             ReadyCallback onReady) {
+        std::string key = ModelRegistry::MakeKey(path, options);
+
+        std::lock_guard<std::mutex> lock{mutex};
+        auto it = loading.find(key);
+        if (it != loading.end()) {
+            if (onReady) {
+                it->second->OnReady.push_back(std::move(onReady));
+            }
+            return it->second->Future;
+        }
+
+        auto request = std::make_shared<Request>();
+        request->Path = path;
+        request->Key = key;
+        request->Options = options;
+        if (onReady) {
+            request->OnReady.push_back(std::move(onReady));
+        }
+        request->Future = request->Promise.get_future().share();
+        std::shared_future<std::shared_ptr<Model>> future = request->Future;
+        loading.emplace(std::move(key), request);
+
+        // Already resident: skip the load, but still publish from Update so callers see the same
+        // ordering either way.
+        if (registry != nullptr) {
+            request->Model = registry->Find(path, options);
+        }
+
+        ++pendingCount;
+        if (request->Model != nullptr) {
+            parsed.push_back(std::move(request));
+            return future;
+        }
+
+        ++parsingCount;
+        pool.Submit([this, request]() {
+            try {
+                request->Mesh = Model::LoadMesh(request->Path, request->Options);
+            } catch (...) {
+                request->Error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock{mutex};
+            parsed.push_back(request);
+            --parsingCount;
+            parsingDone.notify_all();
+        });
+        return future;
+    }
+
+    void ModelStreamer::Update() {
+        // Upload tickets retire in submission order, so batches finish in order too.
+        while (!inFlight.empty() && inFlight.front().Upload->IsComplete()) {
+            for (auto &request : inFlight.front().Requests) {
+                Publish(*request);
+            }
+            inFlight.pop_front();
+        }
+
+        std::vector<std::shared_ptr<Request>> ready;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            VkDeviceSize frameBytes = 0;
+            while (!parsed.empty()) {
+                const Model::MeshView &mesh = parsed.front()->Mesh;
+                VkDeviceSize bytes =
+                    static_cast<VkDeviceSize>(mesh.VertexStride()) * mesh.VertexCount +
+                    static_cast<VkDeviceSize>(mesh.IndexSize) * mesh.IndexCount;
+
+                // Always take at least one mesh, however large, so nothing starves.
+                if (frameBytes > 0 && frameBytes + bytes > MAX_UPLOAD_BYTES_PER_FRAME) {
+                    break;
+                }
+                frameBytes += bytes;
+                ready.push_back(std::move(parsed.front()));
+                parsed.pop_front();
+            }
+        }
+
+        Batch batch{};
+        for (auto &request : ready) {
+            if (request->Error == nullptr && request->Model == nullptr) {
+                try {
+                    if (batch.Upload == nullptr) {
+                        batch.Upload = std::make_unique<UploadBatch>(device);
+                    }
+                    request->Model = std::make_shared<Model>(
+                        device, request->Mesh, batch.Upload.get(), geometryPool);
+                    batch.Requests.push_back(request);
+                    continue;
+                } catch (...) {
+                    request->Error = std::current_exception();
+
+                    // Copies already recorded may target the failed model's buffers, so the
+                    // batch cannot be submitted. The meshes before it are retried next frame.
+                    for (auto &queued : batch.Requests) {
+                        queued->Model = nullptr;
+                    }
+                    std::lock_guard<std::mutex> lock{mutex};
+                    parsed.insert(parsed.begin(), batch.Requests.begin(), batch.Requests.end());
+                    batch = {};
+                }
+            }
+            Publish(*request);
+        }
+
+        if (!batch.Requests.empty()) {
+            batch.Upload->Submit();
+            // The staging buffers hold their own copy of the data now.
+            for (auto &request : batch.Requests) {
+                request->Mesh = {};
+            }
+            inFlight.push_back(std::move(batch));
+        }
+    }
+
+    size_t ModelStreamer::PendingCount() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        return pendingCount;
+    }
+
+    void ModelStreamer::Publish(Request &request) {
+        // Once the request leaves the map no more callbacks can join it, so they are safe to
+        // read without the lock.
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            --pendingCount;
+            loading.erase(request.Key);
+        }
+
+        if (request.Error != nullptr) {
+            try {
+                std::rethrow_exception(request.Error);
+            } catch (const std::exception &e) {
+                std::cerr << "Failed to stream model " << request.Path << ": " << e.what()
+                          << std::endl;
+            } catch (...) {
+                std::cerr << "Failed to stream model " << request.Path << std::endl;
+            }
+            request.Promise.set_exception(request.Error);
+            return;
+        }
+
+        // The upload is complete, so defragmentation may move the model from now on.
+        std::shared_ptr<Model> model = request.Model;
+        model->EnableRelocation();
+        if (registry != nullptr) {
+            model = registry->Adopt(request.Path, request.Options, std::move(model));
+        }
+
+        request.Promise.set_value(model);
+        for (auto &onReady : request.OnReady) {
+            onReady(model);
+        }
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef MODEL_STREAMER_H
+#define MODEL_STREAMER_H
+
+#include "core.h"
+#include "device.h"
+#include "geometrypool.h"
+#include "model.h"
+#include "modelregistry.h"
+#include "threadpool.h"
+#include "uploadbatch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace XIV::Render {
+    // Loads models in the background without stalling the frame loop. Files are parsed on the
+    // thread pool; Update, called once per frame on the render thread, batches finished meshes
+    // into fenced uploads and hands out each model only after its upload has completed.
+    class ModelStreamer {
+    public:
+        // Caps how much mesh data is submitted per frame, so a large burst spreads out instead
+        // of producing one long upload.
+        static constexpr VkDeviceSize MAX_UPLOAD_BYTES_PER_FRAME = 32ull * 1024 * 1024;
+
+        // Runs on the render thread from Update, once the model is safe to draw.
+        using ReadyCallback = std::function<void(const std::shared_ptr<Model> &)>;
+
+        // With a registry, resident models are reused and streamed models are shared through it.
+        // With a geometry pool, streamed models are suballocated from it.
+        ModelStreamer(Device &device,
+                      ModelRegistry *registry = nullptr,
+                      GeometryPool *geometryPool = nullptr,
+                      ThreadPool &pool = ThreadPool::Shared());
+        // Waits for outstanding parses and uploads; their callbacks are not run.
+        ~ModelStreamer();
+        ModelStreamer(const ModelStreamer &) = delete;
+        ModelStreamer &operator=(const ModelStreamer &) = delete;
+
+        // Starts loading path and returns immediately. The future becomes ready, and onReady
+        // runs, from a later Update. A failed load stores its exception in the future. Calls for
+        // a model that is already on its way share that request instead of loading it again.
+        std::shared_future<std::shared_ptr<Model>> LoadAsync(const std::string &path,
+                                                             const ModelLoadOptions &options = {},
+                                                             ReadyCallback onReady = {});
+
+        // Publishes completed uploads and submits newly parsed meshes. Never blocks on the GPU.
+        void Update();
+
+        // Requests that have not been published yet.
+        size_t PendingCount() const;
+
+    private:
+        struct Request {
+            std::string Path{};
+            std::string Key{};
+            ModelLoadOptions Options{};
+            std::vector<ReadyCallback> OnReady{};
+            std::promise<std::shared_ptr<Model>> Promise{};
+            std::shared_future<std::shared_ptr<Model>> Future{};
+            Model::MeshView Mesh{};
+            std::shared_ptr<Model> Model{};
+            std::exception_ptr Error{};
+        };
+
+        struct Batch {
+            std::unique_ptr<UploadBatch> Upload{};
+            std::vector<std::shared_ptr<Request>> Requests{};
+        };
+
+        void Publish(Request &request);
+
+        Device &device;
+        ModelRegistry *registry;
+        GeometryPool *geometryPool;
+        ThreadPool &pool;
+
+        mutable std::mutex mutex;
+        std::condition_variable parsingDone;
+        std::deque<std::shared_ptr<Request>> parsed;
+        size_t parsingCount = 0;
+        size_t pendingCount = 0;
+        std::deque<Batch> inFlight;
+        // Requests not yet published, by model key, so repeated loads can join them.
+        std::unordered_map<std::string, std::shared_ptr<Request>> loading;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
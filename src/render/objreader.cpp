@@ -0,0 +1,449 @@
+#include "objreader.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace XIV::Render {
+    namespace {
+        // Negative (relative) indices can only be resolved once the attribute counts of all
+        // previous chunks are known, so the first pass stores them chunk-local and biased far
+        // below -1 to keep them apart from absolute indices and the "missing" marker.
+        constexpr i32 RELATIVE_BIAS = 1 << 30;
+
+        struct Chunk {
+            const char *Begin = nullptr;
+            const char *End = nullptr;
+
+            std::vector<float> Positions{};
+            std::vector<float> Colors{};
+            std::vector<float> Normals{};
+            std::vector<float> Texcoords{};
+            std::vector<ObjData::Index> Corners{};
+            std::vector<u32> FaceSizes{};
+            size_t TriangleCount = 0;
+
+            size_t PositionBase = 0;
+            size_t NormalBase = 0;
+            size_t TexcoordBase = 0;
+            size_t IndexBase = 0;
+        };
+
+        inline bool IsSpace(char c) {
+            return c == ' ' || c == '\t';
+        }
+
+        inline bool IsDigit(char c) {
+            return c >= '0' && c <= '9';
+        }
+
+        inline const char *SkipSpace(const char *p, const char *end) {
+            while (p < end && IsSpace(*p)) {
+                ++p;
+            }
+            return p;
+        }
+
+        double PowerOfTen(i32 exponent) {
+            static const double exact[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                           1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                           1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+            if (exponent >= 0 && exponent <= 22) {
+                return exact[exponent];
+            }
+            return std::pow(10.0, exponent);
+        }
+
+        // Parses a decimal float starting at p (after optional whitespace). Returns the position
+        // after the number, or nullptr when there is no number.
+        const char *ParseFloat(const char *p, const char *end, float &out) {
+            p = SkipSpace(p, end);
+            const char *start = p;
+
+            bool isNegative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                isNegative = *p == '-';
+                ++p;
+            }
+
+            u64 mantissa = 0;
+            i32 exponent = 0;
+            i32 digitCount = 0;
+            bool hasDigits = false;
+
+            for (; p < end && IsDigit(*p); ++p) {
+                hasDigits = true;
+                if (digitCount < 19) {
+                    mantissa = mantissa * 10 + static_cast<u64>(*p - '0');
+                    digitCount += mantissa > 0;
+                } else {
+                    ++exponent;
+                }
+            }
+
+            if (p < end && *p == '.') {
+                for (++p; p < end && IsDigit(*p); ++p) {
+                    hasDigits = true;
+                    if (digitCount < 19) {
+                        mantissa = mantissa * 10 + static_cast<u64>(*p - '0');
+                        digitCount += mantissa > 0;
+                        --exponent;
+                    }
+                }
+            }
+
+            if (!hasDigits) {
+                // Leave the odd "nan"/"inf" to the C library.
+                char buffer[32];
+                size_t length = 0;
+                while (start + length < end && length < sizeof(buffer) - 1 &&
+                       !IsSpace(start[length]) && start[length] != '\r' && start[length] != '\n') {
+                    buffer[length] = start[length];
+                    ++length;
+                }
+                if (length == 0) {
+                    return nullptr;
+                }
+                buffer[length] = '\0';
+
+                char *parsedEnd = nullptr;
+                double value = std::strtod(buffer, &parsedEnd);
+                if (parsedEnd == buffer) {
+                    return nullptr;
+                }
+                out = static_cast<float>(value);
+                return start + (parsedEnd - buffer);
+            }
+
+            if (p < end && (*p == 'e' || *p == 'E')) {
+                const char *exponentStart = p++;
+                bool isExponentNegative = false;
+                if (p < end && (*p == '-' || *p == '+')) {
+                    isExponentNegative = *p == '-';
+                    ++p;
+                }
+
+                if (p < end && IsDigit(*p)) {
+                    i32 value = 0;
+                    for (; p < end && IsDigit(*p); ++p) {
+                        value = std::min(value * 10 + (*p - '0'), 100000);
+                    }
+                    exponent += isExponentNegative ? -value : value;
+                } else {
+                    p = exponentStart;
+                }
+            }
+
+            double value = static_cast<double>(mantissa);
+            if (mantissa != 0) {
+                value = exponent < 0 ? value / PowerOfTen(-exponent) : value * PowerOfTen(exponent);
+            }
+            out = static_cast<float>(isNegative ? -value : value);
+            return p;
+        }
+
+        const char *ParseInt(const char *p, const char *end, i32 &out) {
+            bool isNegative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                isNegative = *p == '-';
+                ++p;
+            }
+            if (p >= end || !IsDigit(*p)) {
+                return nullptr;
+            }
+
+            i64 value = 0;
+            for (; p < end && IsDigit(*p); ++p) {
+                value = std::min<i64>(value * 10 + (*p - '0'), RELATIVE_BIAS);
+            }
+            out = static_cast<i32>(isNegative ? -value : value);
+            return p;
+        }
+
+        // OBJ indices are 1-based, or relative to the end of the list when negative.
+        inline i32 EncodeIndex(i32 index, size_t localCount) {
+            if (index > 0) {
+                return index - 1;
+            }
+            if (index < 0) {
+                return static_cast<i32>(localCount) + index - RELATIVE_BIAS;
+            }
+            return -1;
+        }
+
+        inline i32 DecodeIndex(i32 index, size_t base, size_t count) {
+            if (index < -1) {
+                index = static_cast<i32>(static_cast<i64>(base) + index + RELATIVE_BIAS);
+            }
+            return (index >= 0 && static_cast<size_t>(index) < count) ? index : -1;
+        }
+
+        void ParseFace(const char *p, const char *end, Chunk &chunk) {
+            u32 cornerCount = 0;
+
+            while (true) {
+                p = SkipSpace(p, end);
+                if (p >= end) {
+                    break;
+                }
+
+                i32 position = 0;
+                i32 texcoord = 0;
+                i32 normal = 0;
+
+                p = ParseInt(p, end, position);
+                if (!p) {
+                    break;
+                }
+
+                if (p < end && *p == '/') {
+                    ++p;
+                    if (p < end && *p != '/') {
+                        const char *next = ParseInt(p, end, texcoord);
+                        p = next ? next : p;
+                    }
+                    if (p < end && *p == '/') {
+                        ++p;
+                        const char *next = ParseInt(p, end, normal);
+                        p = next ? next : p;
+                    }
+                }
+
+                ObjData::Index corner{};
+                corner.Position = EncodeIndex(position, chunk.Positions.size() / 3);
+                corner.Texcoord = EncodeIndex(texcoord, chunk.Texcoords.size() / 2);
+                corner.Normal = EncodeIndex(normal, chunk.Normals.size() / 3);
+                chunk.Corners.push_back(corner);
+                ++cornerCount;
+
+                // Skip anything we did not understand up to the next corner.
+                while (p < end && !IsSpace(*p)) {
+                    ++p;
+                }
+            }
+
+            if (cornerCount < 3) {
+                chunk.Corners.resize(chunk.Corners.size() - cornerCount);
+                return;
+            }
+
+            chunk.FaceSizes.push_back(cornerCount);
+            chunk.TriangleCount += cornerCount - 2;
+        }
+
+        void ParseChunk(Chunk &chunk) {
+            const char *p = chunk.Begin;
+            const char *end = chunk.End;
+
+            while (p < end) {
+                const char *lineEnd =
+                    static_cast<const char *>(memchr(p, '\n', static_cast<size_t>(end - p)));
+                if (!lineEnd) {
+                    lineEnd = end;
+                }
+                const char *next = lineEnd < end ? lineEnd + 1 : end;
+                if (lineEnd > p && lineEnd[-1] == '\r') {
+                    --lineEnd;
+                }
+
+                const char *line = SkipSpace(p, lineEnd);
+                size_t length = static_cast<size_t>(lineEnd - line);
+
+                if (length >= 2 && line[0] == 'v' && IsSpace(line[1])) {
+                    float x = 0.0f, y = 0.0f, z = 0.0f;
+                    const char *cursor = line + 2;
+                    for (float *value : {&x, &y, &z}) {
+                        const char *parsed = ParseFloat(cursor, lineEnd, *value);
+                        cursor = parsed ? parsed : cursor;
+                    }
+                    chunk.Positions.insert(chunk.Positions.end(), {x, y, z});
+
+                    // Optional vertex colors, defaulting to white like tinyobj.
+                    float r = 1.0f, g = 1.0f, b = 1.0f;
+                    const char *red = ParseFloat(cursor, lineEnd, r);
+                    const char *green = red ? ParseFloat(red, lineEnd, g) : nullptr;
+                    const char *blue = green ? ParseFloat(green, lineEnd, b) : nullptr;
+                    if (!blue) {
+                        r = g = b = 1.0f;
+                    }
+                    chunk.Colors.insert(chunk.Colors.end(), {r, g, b});
+                } else if (length >= 3 && line[0] == 'v' && line[1] == 'n' && IsSpace(line[2])) {
+                    float x = 0.0f, y = 0.0f, z = 0.0f;
+                    const char *cursor = line + 3;
+                    for (float *value : {&x, &y, &z}) {
+                        const char *parsed = ParseFloat(cursor, lineEnd, *value);
+                        cursor = parsed ? parsed : cursor;
+                    }
+                    chunk.Normals.insert(chunk.Normals.end(), {x, y, z});
+                } else if (length >= 3 && line[0] == 'v' && line[1] == 't' && IsSpace(line[2])) {
+                    float u = 0.0f, v = 0.0f;
+                    const char *cursor = line + 3;
+                    for (float *value : {&u, &v}) {
+                        const char *parsed = ParseFloat(cursor, lineEnd, *value);
+                        cursor = parsed ? parsed : cursor;
+                    }
+                    chunk.Texcoords.insert(chunk.Texcoords.end(), {u, v});
+                } else if (length >= 2 && line[0] == 'f' && IsSpace(line[1])) {
+                    ParseFace(line + 2, lineEnd, chunk);
+                }
+
+                p = next;
+            }
+        }
+
+        void ResolveChunk(const Chunk &chunk, ObjData &data) {
+            size_t positionCount = data.Positions.size() / 3;
+            size_t normalCount = data.Normals.size() / 3;
+            size_t texcoordCount = data.Texcoords.size() / 2;
+
+            auto resolve = [&](ObjData::Index corner) {
+                corner.Position = DecodeIndex(corner.Position, chunk.PositionBase, positionCount);
+                corner.Normal = DecodeIndex(corner.Normal, chunk.NormalBase, normalCount);
+                corner.Texcoord = DecodeIndex(corner.Texcoord, chunk.TexcoordBase, texcoordCount);
+                return corner;
+            };
+
+            auto squaredDistance = [&data](i32 a, i32 b) {
+                const float *pa = &data.Positions[3 * static_cast<size_t>(a)];
+                const float *pb = &data.Positions[3 * static_cast<size_t>(b)];
+                float x = pb[0] - pa[0], y = pb[1] - pa[1], z = pb[2] - pa[2];
+                return x * x + y * y + z * z;
+            };
+
+            ObjData::Index *out = data.Indices.data() + chunk.IndexBase;
+            const ObjData::Index *in = chunk.Corners.data();
+            ObjData::Index face[4];
+
+            for (u32 faceSize : chunk.FaceSizes) {
+                const ObjData::Index *corners = in;
+                in += faceSize;
+
+                // Faces pointing at vertices that do not exist are dropped rather than read out of
+                // bounds later.
+                bool isValid = true;
+                for (u32 i = 0; i < faceSize; ++i) {
+                    isValid = isValid && resolve(corners[i]).Position >= 0;
+                }
+                if (!isValid) {
+                    for (u32 i = 0; i < 3 * (faceSize - 2); ++i) {
+                        *out++ = ObjData::Index{};
+                    }
+                    continue;
+                }
+
+                if (faceSize == 4) {
+                    for (u32 i = 0; i < 4; ++i) {
+                        face[i] = resolve(corners[i]);
+                    }
+
+                    if (squaredDistance(face[0].Position, face[2].Position) <
+                        squaredDistance(face[1].Position, face[3].Position)) {
+                        *out++ = face[0], *out++ = face[1], *out++ = face[2];
+                        *out++ = face[0], *out++ = face[2], *out++ = face[3];
+                    } else {
+                        *out++ = face[0], *out++ = face[1], *out++ = face[3];
+                        *out++ = face[1], *out++ = face[2], *out++ = face[3];
+                    }
+                    continue;
+                }
+
+                ObjData::Index first = resolve(corners[0]);
+                for (u32 i = 1; i + 1 < faceSize; ++i) {
+                    *out++ = first;
+                    *out++ = resolve(corners[i]);
+                    *out++ = resolve(corners[i + 1]);
+                }
+            }
+        }
+    } // namespace
+
+    void ObjReader::Read(const std::string &filePath, ObjData &data, ThreadPool &pool) {
+        MappedFile file;
+        if (!file.Open(filePath)) {
+            throw std::runtime_error("Failed to open OBJ file: " + filePath);
+        }
+
+        data = ObjData{};
+
+        const char *begin = reinterpret_cast<const char *>(file.Data());
+        const char *end = begin + file.Size();
+
+        // Split on line boundaries into a few chunks per thread to even out the load.
+        size_t targetChunks = static_cast<size_t>(pool.ThreadCount() + 1) * 4;
+        size_t chunkSize = std::max(MIN_CHUNK_SIZE, file.Size() / targetChunks + 1);
+
+        std::vector<Chunk> chunks;
+        for (const char *p = begin; p < end;) {
+            const char *chunkEnd = end;
+            if (static_cast<size_t>(end - p) > chunkSize) {
+                const char *newline = static_cast<const char *>(
+                    memchr(p + chunkSize, '\n', static_cast<size_t>(end - p - chunkSize)));
+                chunkEnd = newline ? newline + 1 : end;
+            }
+
+            Chunk chunk{};
+            chunk.Begin = p;
+            chunk.End = chunkEnd;
+            chunks.push_back(std::move(chunk));
+            p = chunkEnd;
+        }
+
+        pool.ParallelFor(static_cast<u32>(chunks.size()),
+                         [&chunks](u32 i) { ParseChunk(chunks[i]); });
+
+        size_t positionFloats = 0, normalFloats = 0, texcoordFloats = 0, indexCount = 0;
+        for (auto &chunk : chunks) {
+            chunk.PositionBase = positionFloats / 3;
+            chunk.NormalBase = normalFloats / 3;
+            chunk.TexcoordBase = texcoordFloats / 2;
+            chunk.IndexBase = indexCount;
+
+            positionFloats += chunk.Positions.size();
+            normalFloats += chunk.Normals.size();
+            texcoordFloats += chunk.Texcoords.size();
+            indexCount += 3 * chunk.TriangleCount;
+        }
+
+        if (positionFloats / 3 >= static_cast<size_t>(RELATIVE_BIAS / 2) ||
+            indexCount > static_cast<size_t>(UINT32_MAX)) {
+            throw std::runtime_error("OBJ file is too large: " + filePath);
+        }
+
+        data.Positions.resize(positionFloats);
+        data.Colors.resize(positionFloats);
+        data.Normals.resize(normalFloats);
+        data.Texcoords.resize(texcoordFloats);
+        data.Indices.resize(indexCount);
+
+        // Attributes have to be in place before faces resolve, since quads look at positions.
+        pool.ParallelFor(static_cast<u32>(chunks.size()), [&chunks, &data](u32 i) {
+            Chunk &chunk = chunks[i];
+            std::copy(chunk.Positions.begin(), chunk.Positions.end(),
+                      data.Positions.begin() + 3 * chunk.PositionBase);
+            std::copy(chunk.Colors.begin(), chunk.Colors.end(),
+                      data.Colors.begin() + 3 * chunk.PositionBase);
+            std::copy(chunk.Normals.begin(), chunk.Normals.end(),
+                      data.Normals.begin() + 3 * chunk.NormalBase);
+            std::copy(chunk.Texcoords.begin(), chunk.Texcoords.end(),
+                      data.Texcoords.begin() + 2 * chunk.TexcoordBase);
+            chunk.Positions = {};
+            chunk.Colors = {};
+            chunk.Normals = {};
+            chunk.Texcoords = {};
+        });
+
+        pool.ParallelFor(static_cast<u32>(chunks.size()),
+                         [&chunks, &data](u32 i) { ResolveChunk(chunks[i], data); });
+
+        // Compact away the placeholders left by dropped faces.
+        auto isDropped = [](const ObjData::Index &index) { return index.Position < 0; };
+        if (std::any_of(data.Indices.begin(), data.Indices.end(), isDropped)) {
+            data.Indices.erase(
+                std::remove_if(data.Indices.begin(), data.Indices.end(), isDropped),
+                data.Indices.end());
+        }
+    }
+} // namespace XIV::Render
\ No newline at end of file
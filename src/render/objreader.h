@@ -0,0 +1,42 @@
+#ifndef OBJ_READER_H
+#define OBJ_READER_H
+
+#include "core.h"
+#include "threadpool.h"
+
+#include <string>
+#include <vector>
+
+namespace XIV::Render {
+    // Attribute streams of an OBJ file, laid out the same way tinyobj's attrib_t is, plus the
+    // triangulated face corners of every group in file order.
+    struct ObjData {
+        struct Index {
+            i32 Position = -1;
+            i32 Normal = -1;
+            i32 Texcoord = -1;
+        };
+
+        std::vector<float> Positions{}; // xyz
+        std::vector<float> Colors{};    // rgb per position, 1.0 when the file has none
+        std::vector<float> Normals{};   // xyz
+        std::vector<float> Texcoords{}; // uv
+        std::vector<Index> Indices{};   // three per triangle
+    };
+
+    // Geometry-only OBJ reader that parses line-aligned chunks of a memory-mapped file on the
+    // thread pool. Chunks are merged in file order, so the result does not depend on the number
+    // of threads. Materials, groups and smoothing groups are skipped; quads are split along the
+    // shorter diagonal like tinyobj does, larger polygons are fanned.
+    class ObjReader {
+    public:
+        // Files smaller than this are parsed as a single chunk.
+        static constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+        static void Read(const std::string &filePath,
+                         ObjData &data,
+                         ThreadPool &pool = ThreadPool::Shared());
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
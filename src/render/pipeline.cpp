@@ -20,12 +20,18 @@ namespace XIV::Render {
     }
 
     Pipeline::~Pipeline() {
-        vkDestroyShaderModule(device.VulkanDevice, fragShaderModule, nullptr);
-        vkDestroyShaderModule(device.VulkanDevice, vertShaderModule, nullptr);
-        vkDestroyPipeline(device.VulkanDevice, graphicsPipeline, nullptr);
+        vkDestroyShaderModule(device.VulkanDevice, fragShaderModule, device.HostCallbacks());
+        vkDestroyShaderModule(device.VulkanDevice, vertShaderModule, device.HostCallbacks());
+        // Command buffers of frames in flight may still reference the pipeline.
+        VkDevice vulkanDevice = device.VulkanDevice;
+        VkPipeline pipeline = graphicsPipeline;
+        const VkAllocationCallbacks *callbacks = device.HostCallbacks();
+        device.GetDeletionQueue().Enqueue([vulkanDevice, pipeline, callbacks]() {
+            vkDestroyPipeline(vulkanDevice, pipeline, callbacks);
+        });
     }
 
-    void Pipeline::DefaultConfigInfo(PipelineConfigInfo &configInfo) {
+    void Pipeline::DefaultConfigInfo(PipelineConfigInfo &configInfo, VertexFormat format) {
         configInfo.InputAssemblyInfo.sType =
             VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
         configInfo.InputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -98,8 +104,13 @@ namespace XIV::Render {
             static_cast<u32>(configInfo.DynamicStateEnables.size());
         configInfo.DynamicStateInfo.flags = 0;
 
-        configInfo.BindingDescriptions = Model::Vertex::GetBindingDescriptions();
-        configInfo.AttributeDescriptions = Model::Vertex::GetAttributeDescriptions();
+        if (format == VertexFormat::Compact) {
+            configInfo.BindingDescriptions = Model::CompactVertex::GetBindingDescriptions();
+            configInfo.AttributeDescriptions = Model::CompactVertex::GetAttributeDescriptions();
+        } else {
+            configInfo.BindingDescriptions = Model::Vertex::GetBindingDescriptions();
+            configInfo.AttributeDescriptions = Model::Vertex::GetAttributeDescriptions();
+        }
     }
 
     void Pipeline::EnableAlphaBlending(PipelineConfigInfo &configInfo) {
@@ -198,12 +209,8 @@ namespace XIV::Render {
         pipelineInfo.basePipelineIndex = -1;              // Optional
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 
-        if (vkCreateGraphicsPipelines(device.VulkanDevice,
-                                      VK_NULL_HANDLE,
-                                      1,
-                                      &pipelineInfo,
-                                      nullptr,
-                                      &graphicsPipeline) != VK_SUCCESS) {
+        if (device.GetPipelineCache().CreateGraphicsPipeline(pipelineInfo, graphicsPipeline) !=
+            VK_SUCCESS) {
             throw std::runtime_error("failed to create graphics pipeline");
         }
     }
@@ -214,7 +221,9 @@ namespace XIV::Render {
         createInfo.codeSize = code.size();
         createInfo.pCode = reinterpret_cast<const u32 *>(code.data());
 
-        if (vkCreateShaderModule(device.VulkanDevice, &createInfo, nullptr, shaderModule) !=
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_SHADER_MODULE};
+        if (vkCreateShaderModule(
+                device.VulkanDevice, &createInfo, device.HostCallbacks(), shaderModule) !=
             VK_SUCCESS) {
             throw std::runtime_error("Failed to create shader module.");
         }
@@ -3,6 +3,7 @@
 
 #include "core.h"
 #include "device.h"
+#include "model.h"
 
 #include <string>
 #include <vector>
@@ -39,7 +40,8 @@ namespace XIV::Render {
         Pipeline(const Pipeline &) = delete;
         Pipeline &operator=(const Pipeline &) = delete;
 
-        static void DefaultConfigInfo(PipelineConfigInfo &configInfo);
+        static void DefaultConfigInfo(PipelineConfigInfo &configInfo,
+                                      VertexFormat format = VertexFormat::Full);
         static void EnableAlphaBlending(PipelineConfigInfo &configInfo);
 
         void Bind(VkCommandBuffer commandBuffer);
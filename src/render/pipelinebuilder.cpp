@@ -0,0 +1,92 @@
+#include "pipelinebuilder.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <exception>
+
+namespace XIV::Render {
+    struct PipelineHandle::Job {
+        Job(Device &device,
+            const std::string &vertPath,
+            const std::string &fragPath,
+            std::unique_ptr<PipelineConfigInfo> configInfo)
+            : TargetDevice{device}, VertPath{vertPath}, FragPath{fragPath},
+              ConfigInfo{std::move(configInfo)} {}
+
+        Device &TargetDevice;
+        std::string VertPath;
+        std::string FragPath;
+        std::unique_ptr<PipelineConfigInfo> ConfigInfo;
+        std::promise<std::unique_ptr<Pipeline>> Result{};
+        std::atomic<bool> IsClaimed{false};
+
+        // Whichever of the pool and the waiting thread gets here first builds the pipeline.
+        void TryRun() {
+            if (IsClaimed.exchange(true)) {
+                return;
+            }
+            try {
+                Result.set_value(
+                    std::make_unique<Pipeline>(TargetDevice, VertPath, FragPath, *ConfigInfo));
+            } catch (...) {
+                Result.set_exception(std::current_exception());
+            }
+            ConfigInfo.reset();
+        }
+    };
+
+    PipelineHandle::~PipelineHandle() {
+        Wait();
+    }
+
+    PipelineHandle &PipelineHandle::operator=(PipelineHandle &&other) {
+        if (this != &other) {
+            Wait();
+            job = std::move(other.job);
+            future = std::move(other.future);
+            pipeline = std::move(other.pipeline);
+        }
+        return *this;
+    }
+
+    Pipeline &PipelineHandle::Get() {
+        if (pipeline == nullptr) {
+            assert(job != nullptr && "Handle was never given a build");
+            job->TryRun();
+            job.reset();
+            pipeline = future.get();
+        }
+        return *pipeline;
+    }
+
+    bool PipelineHandle::IsReady() const {
+        return pipeline != nullptr ||
+               (future.valid() &&
+                future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+    }
+
+    void PipelineHandle::Wait() {
+        if (job != nullptr) {
+            job->TryRun();
+            future.wait();
+            job.reset();
+        }
+    }
+
+    PipelineBuilder::PipelineBuilder(Device &device, ThreadPool &pool)
+        : device{device}, pool{pool} {}
+
+    PipelineHandle PipelineBuilder::Build(const std::string &vertPath,
+                                          const std::string &fragPath,
+                                          std::unique_ptr<PipelineConfigInfo> configInfo) {
+        auto job = std::make_shared<PipelineHandle::Job>(
+            device, vertPath, fragPath, std::move(configInfo));
+
+        PipelineHandle handle{};
+        handle.future = job->Result.get_future();
+        handle.job = job;
+        pool.Submit([job]() { job->TryRun(); });
+        return handle;
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef PIPELINE_BUILDER_H
+#define PIPELINE_BUILDER_H
+
+#include "device.h"
+#include "pipeline.h"
+#include "threadpool.h"
+
+#include <future>
+#include <memory>
+#include <string>
+
+namespace XIV::Render {
+    // A pipeline being built in the background. Get waits for it on first use; if no worker
+    // has picked the build up yet, the calling thread runs it instead of queueing behind
+    // unrelated work. Waits for the build on destruction, so none outlives its device.
+    class PipelineHandle {
+    public:
+        PipelineHandle() = default;
+        ~PipelineHandle();
+        PipelineHandle(PipelineHandle &&other) = default;
+        PipelineHandle &operator=(PipelineHandle &&other);
+        PipelineHandle(const PipelineHandle &) = delete;
+        PipelineHandle &operator=(const PipelineHandle &) = delete;
+
+        // Rethrows anything the build threw.
+        Pipeline &Get();
+
+        Pipeline *operator->() {
+            return &Get();
+        }
+
+        bool IsReady() const;
+
+    private:
+        struct Job;
+        friend class PipelineBuilder;
+
+        void Wait();
+
+        std::shared_ptr<Job> job;
+        std::future<std::unique_ptr<Pipeline>> future;
+        std::unique_ptr<Pipeline> pipeline;
+    };
+
+    // Compiles pipelines concurrently on a thread pool, against the device's PipelineCache, so
+    // startup pays for the slowest pipeline rather than the sum of them. Submit everything up
+    // front and only Get the handles when they are first drawn with.
+    class PipelineBuilder {
+    public:
+        explicit PipelineBuilder(Device &device, ThreadPool &pool = ThreadPool::Shared());
+        PipelineBuilder(const PipelineBuilder &) = delete;
+        PipelineBuilder &operator=(const PipelineBuilder &) = delete;
+
+        // configInfo is owned by the build until it finishes; its layout and render pass must
+        // outlive it.
+        PipelineHandle Build(const std::string &vertPath,
+                             const std::string &fragPath,
+                             std::unique_ptr<PipelineConfigInfo> configInfo);
+
+    private:
+        Device &device;
+        ThreadPool &pool;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "pipelinecache.h"
+
+#include "device.h"
+#include "mappedfile.h"
+#include "utils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace XIV::Render {
+    PipelineCache::PipelineCache(Device &device, std::string path)
+        : device{device}, path{std::move(path)} {
+        std::vector<u8> data{};
+        stats.IsWarm = Load(data);
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = data.size();
+        cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_PIPELINE_CACHE};
+        VkResult result = vkCreatePipelineCache(
+            device.VulkanDevice, &cacheInfo, device.HostCallbacks(), &cache);
+        if (result != VK_SUCCESS && stats.IsWarm) {
+            // The driver may still refuse data that passed our checks; start cold instead.
+            std::cerr << "Discarding pipeline cache: " << this->path << std::endl;
+            stats.IsWarm = false;
+            cacheInfo.initialDataSize = 0;
+            cacheInfo.pInitialData = nullptr;
+            result = vkCreatePipelineCache(
+                device.VulkanDevice, &cacheInfo, device.HostCallbacks(), &cache);
+        }
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+
+    PipelineCache::~PipelineCache() {
+        Save();
+        vkDestroyPipelineCache(device.VulkanDevice, cache, device.HostCallbacks());
+    }
+
+    VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo &pipelineInfo,
+                                                   VkPipeline &pipeline) {
+        VkGraphicsPipelineCreateInfo info = pipelineInfo;
+        VkPipelineCreationFeedbackEXT feedback{};
+        std::vector<VkPipelineCreationFeedbackEXT> stageFeedbacks(info.stageCount);
+        VkPipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+        if (device.IsPipelineFeedbackSupported()) {
+            feedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+            feedbackInfo.pNext = info.pNext;
+            feedbackInfo.pPipelineCreationFeedback = &feedback;
+            feedbackInfo.pipelineStageCreationFeedbackCount = info.stageCount;
+            feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedbacks.data();
+            info.pNext = &feedbackInfo;
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_PIPELINE};
+        VkResult result = vkCreateGraphicsPipelines(
+            device.VulkanDevice, cache, 1, &info, device.HostCallbacks(), &pipeline);
+        auto elapsed = std::chrono::high_resolution_clock::now() - start;
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        std::lock_guard<std::mutex> lock{statsMutex};
+        ++stats.Pipelines;
+        if ((feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT) != 0) {
+            constexpr VkPipelineCreationFeedbackFlagsEXT HIT_BIT =
+                VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT;
+            if ((feedback.flags & HIT_BIT) != 0) {
+                ++stats.Hits;
+            } else {
+                ++stats.Misses;
+            }
+            stats.CreationNanoseconds += feedback.duration;
+        } else {
+            stats.CreationNanoseconds += static_cast<u64>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+        return result;
+    }
+
+    void PipelineCache::Save() {
+        size_t size = 0;
+        if (vkGetPipelineCacheData(device.VulkanDevice, cache, &size, nullptr) != VK_SUCCESS) {
+            std::cerr << "Failed to read pipeline cache data" << std::endl;
+            return;
+        }
+        std::vector<u8> data(size);
+        if (vkGetPipelineCacheData(device.VulkanDevice, cache, &size, data.data()) != VK_SUCCESS) {
+            std::cerr << "Failed to read pipeline cache data" << std::endl;
+            return;
+        }
+        data.resize(size);
+
+        Header header{};
+        FillHeader(header);
+        header.DataSize = data.size();
+        header.DataHash = HashBytes(data.data(), data.size());
+
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+            if (!file.is_open()) {
+                std::cerr << "Failed to write pipeline cache: " << tempPath << std::endl;
+                return;
+            }
+
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(data.data()),
+                       static_cast<std::streamsize>(data.size()));
+
+            if (!file.good()) {
+                std::cerr << "Failed to write pipeline cache: " << tempPath << std::endl;
+                file.close();
+                std::remove(tempPath.c_str());
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error) {
+            std::cerr << "Failed to write pipeline cache: " << path << " (" << error.message()
+                      << ")" << std::endl;
+            std::remove(tempPath.c_str());
+        }
+    }
+
+    PipelineCacheStats PipelineCache::GetStats() const {
+        std::lock_guard<std::mutex> lock{statsMutex};
+        return stats;
+    }
+
+    void PipelineCache::PrintStats(std::ostream &out) const {
+        PipelineCacheStats snapshot = GetStats();
+        out << "Pipeline cache (" << (snapshot.IsWarm ? "warm" : "cold") << "): "
+            << snapshot.Pipelines << " pipelines, " << snapshot.Hits << " hits, "
+            << snapshot.Misses << " misses, " << snapshot.CreationNanoseconds / 1000000.0
+            << " ms creating" << std::endl;
+    }
+
+    bool PipelineCache::Load(std::vector<u8> &data) {
+        MappedFile file;
+        if (!file.Open(path) || file.Size() < sizeof(Header)) {
+            return false;
+        }
+
+        Header header;
+        std::memcpy(&header, file.Data(), sizeof(header));
+        const u8 *payload = file.Data() + sizeof(Header);
+        if (header.DataSize != file.Size() - sizeof(Header) || !IsCompatible(header, payload)) {
+            std::cerr << "Pipeline cache is stale, rebuilding: " << path << std::endl;
+            return false;
+        }
+
+        data.assign(payload, payload + header.DataSize);
+        return true;
+    }
+
+    bool PipelineCache::IsCompatible(const Header &header, const u8 *data) const {
+        Header expected{};
+        FillHeader(expected);
+        bool isSameDriver =
+            header.Magic == expected.Magic && header.Version == expected.Version &&
+            header.VendorId == expected.VendorId && header.DeviceId == expected.DeviceId &&
+            header.DriverVersion == expected.DriverVersion &&
+            std::memcmp(header.PipelineCacheUuid, expected.PipelineCacheUuid, VK_UUID_SIZE) == 0;
+        if (!isSameDriver || header.DataSize < sizeof(VkPipelineCacheHeaderVersionOne) ||
+            header.DataHash != HashBytes(data, header.DataSize)) {
+            return false;
+        }
+
+        // The driver's own header has to agree as well.
+        VkPipelineCacheHeaderVersionOne driverHeader;
+        std::memcpy(&driverHeader, data, sizeof(driverHeader));
+        return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               driverHeader.vendorID == expected.VendorId &&
+               driverHeader.deviceID == expected.DeviceId &&
+               std::memcmp(driverHeader.pipelineCacheUUID,
+                           expected.PipelineCacheUuid,
+                           VK_UUID_SIZE) == 0;
+    }
+
+    void PipelineCache::FillHeader(Header &header) const {
+        const VkPhysicalDeviceProperties &properties = device.Properties;
+        header.Magic = MAGIC;
+        header.Version = VERSION;
+        header.VendorId = properties.vendorID;
+        header.DeviceId = properties.deviceID;
+        header.DriverVersion = properties.driverVersion;
+        std::memcpy(header.PipelineCacheUuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    }
+} // namespace XIV::Render
\ No newline at end of file
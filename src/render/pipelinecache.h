@@ -0,0 +1,85 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include "core.h"
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace XIV::Render {
+    class Device;
+
+    struct PipelineCacheStats {
+        u64 Pipelines = 0;
+        // Counted from VK_EXT_pipeline_creation_feedback; pipelines built without it are neither.
+        u64 Hits = 0;
+        u64 Misses = 0;
+        u64 CreationNanoseconds = 0;
+        bool IsWarm = false; // started from data on disk
+    };
+
+    // The device's VkPipelineCache, persisted between runs. The file is only loaded when it was
+    // written by the same device, driver version and pipeline cache UUID; anything else starts
+    // cold rather than handing the driver data it would reject or, worse, misread. Saved on
+    // destruction via a temp file + rename, so a crash never leaves a torn cache behind.
+    //
+    // The VkPipelineCache is internally synchronized, so pipelines may be created from any
+    // thread.
+    class PipelineCache {
+    public:
+        static constexpr u32 MAGIC = 0x4F535058; // "XPSO"
+        static constexpr u32 VERSION = 1;
+        static inline const char *DEFAULT_PATH = "pipelines.xpipe";
+
+        // Written ahead of the driver's own cache data.
+        struct Header {
+            u32 Magic;
+            u32 Version;
+            u32 VendorId;
+            u32 DeviceId;
+            u32 DriverVersion;
+            u8 PipelineCacheUuid[VK_UUID_SIZE];
+            u64 DataSize;
+            u64 DataHash;
+        };
+
+        PipelineCache(Device &device, std::string path = DEFAULT_PATH);
+        // Saves, then destroys the cache. The device must still be alive.
+        ~PipelineCache();
+        PipelineCache(const PipelineCache &) = delete;
+        PipelineCache &operator=(const PipelineCache &) = delete;
+
+        VkPipelineCache Handle() const {
+            return cache;
+        }
+
+        // vkCreateGraphicsPipelines against the cache, recording creation feedback when the
+        // device supports it. Safe to call from any thread.
+        VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo &pipelineInfo,
+                                        VkPipeline &pipeline);
+
+        // Writes the current cache contents to disk. Failures are reported but never fatal.
+        void Save();
+
+        PipelineCacheStats GetStats() const;
+        void PrintStats(std::ostream &out) const;
+
+    private:
+        bool Load(std::vector<u8> &data);
+        bool IsCompatible(const Header &header, const u8 *data) const;
+        void FillHeader(Header &header) const;
+
+        Device &device;
+        std::string path;
+        VkPipelineCache cache = VK_NULL_HANDLE;
+
+        mutable std::mutex statsMutex;
+        PipelineCacheStats stats{};
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
@@ -22,6 +22,7 @@ namespace XIV::Render {
             glfwWaitEvents();
         }
         vkDeviceWaitIdle(device.VulkanDevice);
+        device.GetDeletionQueue().Flush();
 
         if (swapChain == nullptr) {
             swapChain = std::make_unique<SwapChain>(device, extent);
@@ -71,6 +72,8 @@ namespace XIV::Render {
             throw std::runtime_error("failed to acquire swap chain image!");
         }
 
+        // Acquiring waited on this frame slot's fence, so older frames are done.
+        device.GetDeletionQueue().BeginFrame();
         IsFrameStarted = true;
 
         auto commandBuffer = GetCurrentCommandBuffer();
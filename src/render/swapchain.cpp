@@ -22,32 +22,34 @@ namespace XIV::Render {
 
     SwapChain::~SwapChain() {
         for (auto imageView : ImageViews) {
-            vkDestroyImageView(device.VulkanDevice, imageView, nullptr);
+            vkDestroyImageView(device.VulkanDevice, imageView, device.HostCallbacks());
         }
         ImageViews.clear();
 
         if (swapChain != nullptr) {
-            vkDestroySwapchainKHR(device.VulkanDevice, swapChain, nullptr);
+            vkDestroySwapchainKHR(device.VulkanDevice, swapChain, device.HostCallbacks());
             swapChain = nullptr;
         }
 
         for (size_t i = 0; i < depthImages.size(); ++i) {
-            vkDestroyImageView(device.VulkanDevice, depthImageViews[i], nullptr);
-            vkDestroyImage(device.VulkanDevice, depthImages[i], nullptr);
-            vkFreeMemory(device.VulkanDevice, depthImageMemories[i], nullptr);
+            vkDestroyImageView(device.VulkanDevice, depthImageViews[i], device.HostCallbacks());
+            vkDestroyImage(device.VulkanDevice, depthImages[i], device.HostCallbacks());
+            device.GetAllocator().Free(depthImageMemories[i]);
         }
 
         for (auto framebuffer : Framebuffers) {
-            vkDestroyFramebuffer(device.VulkanDevice, framebuffer, nullptr);
+            vkDestroyFramebuffer(device.VulkanDevice, framebuffer, device.HostCallbacks());
         }
 
-        vkDestroyRenderPass(device.VulkanDevice, RenderPass, nullptr);
+        vkDestroyRenderPass(device.VulkanDevice, RenderPass, device.HostCallbacks());
 
         // Clean up synchronization objects
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-            vkDestroySemaphore(device.VulkanDevice, renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(device.VulkanDevice, imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device.VulkanDevice, inFlightFences[i], nullptr);
+            vkDestroySemaphore(
+                device.VulkanDevice, renderFinishedSemaphores[i], device.HostCallbacks());
+            vkDestroySemaphore(
+                device.VulkanDevice, imageAvailableSemaphores[i], device.HostCallbacks());
+            vkDestroyFence(device.VulkanDevice, inFlightFences[i], device.HostCallbacks());
         }
     }
 
@@ -100,6 +102,7 @@ namespace XIV::Render {
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         vkResetFences(device.VulkanDevice, 1, &inFlightFences[currentFrame]);
+        std::lock_guard<std::mutex> queueLock{device.GetQueueMutex()};
         if (vkQueueSubmit(device.GraphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) !=
             VK_SUCCESS) {
             throw std::runtime_error("Failed to submit draw command buffer.");
@@ -173,7 +176,9 @@ namespace XIV::Render {
         createInfo.oldSwapchain =
             oldSwapChain == nullptr ? VK_NULL_HANDLE : oldSwapChain->swapChain;
 
-        if (vkCreateSwapchainKHR(device.VulkanDevice, &createInfo, nullptr, &swapChain) !=
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_SWAPCHAIN_KHR};
+        if (vkCreateSwapchainKHR(
+                device.VulkanDevice, &createInfo, device.HostCallbacks(), &swapChain) !=
             VK_SUCCESS) {
             throw std::runtime_error("Failed to create swap chain.");
         }
@@ -204,7 +209,9 @@ namespace XIV::Render {
             viewInfo.subresourceRange.baseArrayLayer = 0;
             viewInfo.subresourceRange.layerCount = 1;
 
-            if (vkCreateImageView(device.VulkanDevice, &viewInfo, nullptr, &ImageViews[i]) !=
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_IMAGE_VIEW};
+            if (vkCreateImageView(
+                    device.VulkanDevice, &viewInfo, device.HostCallbacks(), &ImageViews[i]) !=
                 VK_SUCCESS) {
                 throw std::runtime_error("Failed to create texture image view.");
             }
@@ -253,7 +260,9 @@ namespace XIV::Render {
             viewInfo.subresourceRange.baseArrayLayer = 0;
             viewInfo.subresourceRange.layerCount = 1;
 
-            if (vkCreateImageView(device.VulkanDevice, &viewInfo, nullptr, &depthImageViews[i]) !=
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_IMAGE_VIEW};
+            if (vkCreateImageView(
+                    device.VulkanDevice, &viewInfo, device.HostCallbacks(), &depthImageViews[i]) !=
                 VK_SUCCESS) {
                 throw std::runtime_error("Failed to create texture image view.");
             }
@@ -316,7 +325,9 @@ namespace XIV::Render {
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(device.VulkanDevice, &renderPassInfo, nullptr, &RenderPass) !=
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_RENDER_PASS};
+        if (vkCreateRenderPass(
+                device.VulkanDevice, &renderPassInfo, device.HostCallbacks(), &RenderPass) !=
             VK_SUCCESS) {
             throw std::runtime_error("Failed to create render pass.");
         }
@@ -337,9 +348,10 @@ namespace XIV::Render {
             framebufferInfo.height = swapChainExtent.height;
             framebufferInfo.layers = 1;
 
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_FRAMEBUFFER};
             if (vkCreateFramebuffer(device.VulkanDevice,
                                     &framebufferInfo,
-                                    nullptr,
+                                    device.HostCallbacks(),
                                     &Framebuffers[i]) != VK_SUCCESS) {
                 throw std::runtime_error("Failed to create framebuffer.");
             }
@@ -362,14 +374,16 @@ namespace XIV::Render {
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
             if (vkCreateSemaphore(device.VulkanDevice,
                                   &semaphoreInfo,
-                                  nullptr,
+                                  device.HostCallbacks(),
                                   &imageAvailableSemaphores[i]) != VK_SUCCESS ||
                 vkCreateSemaphore(device.VulkanDevice,
                                   &semaphoreInfo,
-                                  nullptr,
+                                  device.HostCallbacks(),
                                   &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device.VulkanDevice, &fenceInfo, nullptr, &inFlightFences[i]) !=
-                    VK_SUCCESS) {
+                vkCreateFence(device.VulkanDevice,
+                              &fenceInfo,
+                              device.HostCallbacks(),
+                              &inFlightFences[i]) != VK_SUCCESS) {
                 throw std::runtime_error("Failed to create synchronization objects for a frame.");
             }
         }
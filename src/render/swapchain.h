@@ -78,7 +78,7 @@ namespace XIV::Render {
         std::shared_ptr<SwapChain> oldSwapChain;
 
         std::vector<VkImage> depthImages;
-        std::vector<VkDeviceMemory> depthImageMemories;
+        std::vector<MemoryAllocation> depthImageMemories;
         std::vector<VkImageView> depthImageViews;
         std::vector<VkImage> images;
 
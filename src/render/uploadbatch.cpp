@@ -0,0 +1,200 @@
+#include "uploadbatch.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace XIV::Render {
+    UploadBatch::UploadBatch(Device &device) : device{device} {
+        // A pool per batch keeps batches independent of each other and of the thread they are
+        // recorded on.
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = device.GetUploadContext().TransferFamily();
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        {
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_COMMAND_POOL};
+            if (vkCreateCommandPool(
+                    device.VulkanDevice, &poolInfo, device.HostCallbacks(), &commandPool) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("Failed to create upload command pool.");
+            }
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device.VulkanDevice, &allocInfo, &commandBuffer) !=
+            VK_SUCCESS) {
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_COMMAND_POOL};
+            vkDestroyCommandPool(device.VulkanDevice, commandPool, device.HostCallbacks());
+            throw std::runtime_error("Failed to allocate upload command buffer.");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    }
+
+    UploadBatch::~UploadBatch() {
+        if (isSubmitted) {
+            Wait();
+        } else if (!regions.empty()) {
+            device.GetUploadContext().Release(regions);
+        }
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_COMMAND_POOL};
+        vkDestroyCommandPool(device.VulkanDevice, commandPool, device.HostCallbacks());
+    }
+
+    void UploadBatch::CopyToBuffer(const void *data,
+                                   VkDeviceSize size,
+                                   VkBuffer dstBuffer,
+                                   VkDeviceSize dstOffset) {
+        assert(!isSubmitted && "Cannot add copies to a submitted upload batch.");
+        if (size == 0) {
+            return;
+        }
+
+        VkBufferCopy copyRegion{};
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+
+        UploadContext::Staging staging{};
+        if (device.GetUploadContext().AllocateStaging(size, staging)) {
+            memcpy(staging.Mapped, data, size);
+            regions.push_back(staging.Region);
+            copyRegion.srcOffset = staging.Offset;
+            vkCmdCopyBuffer(commandBuffer, staging.Buffer, dstBuffer, 1, &copyRegion);
+        } else {
+            // Too big for the ring, or the ring is held by batches still being recorded.
+            auto stagingBuffer =
+                std::make_unique<Buffer>(device,
+                                         size,
+                                         1,
+                                         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                         MemoryUsage::Staging);
+            stagingBuffer->Map();
+            stagingBuffer->WriteToBuffer(const_cast<void *>(data), size);
+            stagingBuffer->Unmap();
+
+            copyRegion.srcOffset = 0;
+            vkCmdCopyBuffer(commandBuffer, stagingBuffer->VulkanBuffer, dstBuffer, 1, &copyRegion);
+            stagingBuffers.push_back(std::move(stagingBuffer));
+        }
+
+        UploadContext &context = device.GetUploadContext();
+        if (context.IsTransferQueueSeparate()) {
+            VkBufferMemoryBarrier transfer{};
+            transfer.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            transfer.srcQueueFamilyIndex = context.TransferFamily();
+            transfer.dstQueueFamilyIndex = context.GraphicsFamily();
+            transfer.buffer = dstBuffer;
+            transfer.offset = dstOffset;
+            transfer.size = size;
+            ownershipTransfers.push_back(transfer);
+        }
+        bytes += size;
+    }
+
+    void UploadBatch::WriteToBuffer(const void *data,
+                                    VkDeviceSize size,
+                                    Buffer &dstBuffer,
+                                    VkDeviceSize dstOffset) {
+        if (!dstBuffer.IsHostVisible()) {
+            CopyToBuffer(data, size, dstBuffer.VulkanBuffer, dstOffset);
+            return;
+        }
+
+        assert(!isSubmitted && "Cannot add writes to a submitted upload batch.");
+        if (dstBuffer.Mapped == nullptr) {
+            dstBuffer.Map();
+        }
+        memcpy(static_cast<u8 *>(dstBuffer.Mapped) + dstOffset, data, size);
+        dstBuffer.Flush(size, dstOffset);
+        bytes += size;
+    }
+
+    void UploadBatch::Submit() {
+        assert(!isSubmitted && "Upload batch was already submitted.");
+
+        if (!ownershipTransfers.empty()) {
+            SubmitWithOwnershipTransfer();
+            return;
+        }
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                             0,
+                             1,
+                             &barrier,
+                             0,
+                             nullptr,
+                             0,
+                             nullptr);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record upload command buffer.");
+        }
+
+        ticket = device.GetUploadContext().Submit(commandBuffer, regions);
+        isSubmitted = true;
+    }
+
+    void UploadBatch::SubmitWithOwnershipTransfer() {
+        // Release on the transfer queue. Visibility to vertex input comes from the matching
+        // acquire the context records on the graphics queue.
+        std::vector<VkBufferMemoryBarrier> releases = ownershipTransfers;
+        for (auto &release : releases) {
+            release.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            release.dstAccessMask = 0;
+        }
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             static_cast<u32>(releases.size()),
+                             releases.data(),
+                             0,
+                             nullptr);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record upload command buffer.");
+        }
+
+        for (auto &acquire : ownershipTransfers) {
+            acquire.srcAccessMask = 0;
+            acquire.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        }
+        ticket = device.GetUploadContext().Submit(commandBuffer, regions, ownershipTransfers);
+        isSubmitted = true;
+    }
+
+    bool UploadBatch::IsComplete() {
+        if (!isComplete && isSubmitted) {
+            isComplete = device.GetUploadContext().IsComplete(ticket);
+            if (isComplete) {
+                stagingBuffers.clear();
+            }
+        }
+        return isComplete;
+    }
+
+    void UploadBatch::Wait() {
+        if (isComplete || !isSubmitted) {
+            return;
+        }
+        device.GetUploadContext().Wait(ticket);
+        isComplete = true;
+        stagingBuffers.clear();
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef UPLOAD_BATCH_H
+#define UPLOAD_BATCH_H
+
+#include "buffer.h"
+#include "core.h"
+#include "device.h"
+#include "uploadcontext.h"
+
+#include <memory>
+#include <vector>
+
+namespace XIV::Render {
+    // Records staging copies into one command buffer and submits them through the device's
+    // UploadContext, instead of a queue wait per buffer. Staging comes from the context's ring;
+    // its space is reused once the batch's ticket completes.
+    class UploadBatch {
+    public:
+        UploadBatch(Device &device);
+        // Waits for a submitted batch, so its staging memory is never reused while in use.
+        ~UploadBatch();
+        UploadBatch(const UploadBatch &) = delete;
+        UploadBatch &operator=(const UploadBatch &) = delete;
+
+        // Copies size bytes of data into staging memory now and records the transfer to
+        // dstBuffer. Must be called before Submit.
+        void CopyToBuffer(const void *data,
+                          VkDeviceSize size,
+                          VkBuffer dstBuffer,
+                          VkDeviceSize dstOffset = 0);
+
+        // Writes straight into dstBuffer when it is host-visible (unified memory) and otherwise
+        // stages the data like CopyToBuffer. dstBuffer must not be in use by the GPU.
+        void WriteToBuffer(const void *data,
+                           VkDeviceSize size,
+                           Buffer &dstBuffer,
+                           VkDeviceSize dstOffset = 0);
+
+        // Makes the copies visible to vertex input and submits them to the transfer queue,
+        // handing the written ranges over to the graphics queue when the two differ.
+        void Submit();
+        // True once the submitted copies have finished on the GPU.
+        bool IsComplete();
+        void Wait();
+
+        // Zero until submitted.
+        UploadContext::Ticket GetTicket() const {
+            return ticket;
+        }
+
+        VkDeviceSize Bytes() const {
+            return bytes;
+        }
+
+    private:
+        void SubmitWithOwnershipTransfer();
+
+        Device &device;
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::vector<u64> regions;
+        // One per copy; the destination ranges whose ownership moves to the graphics queue.
+        std::vector<VkBufferMemoryBarrier> ownershipTransfers;
+        // Only for copies the ring cannot hold.
+        std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+        UploadContext::Ticket ticket = 0;
+        VkDeviceSize bytes = 0;
+        bool isSubmitted = false;
+        bool isComplete = false;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
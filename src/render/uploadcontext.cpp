@@ -0,0 +1,305 @@
+#include "uploadcontext.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace XIV::Render {
+    namespace {
+        // Keeps every staging slice aligned for any copy source.
+        constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+    } // namespace
+
+    UploadContext::Submission::Submission(VkDevice device,
+                                          const VkAllocationCallbacks *callbacks,
+                                          u64 ticket)
+        : VulkanDevice{device}, Callbacks{callbacks}, Ticket{ticket} {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_FENCE};
+        if (vkCreateFence(VulkanDevice, &fenceInfo, Callbacks, &Fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload fence.");
+        }
+    }
+
+    UploadContext::Submission::~Submission() {
+        {
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_FENCE};
+            vkDestroyFence(VulkanDevice, Fence, Callbacks);
+        }
+        if (Semaphore != VK_NULL_HANDLE) {
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_SEMAPHORE};
+            vkDestroySemaphore(VulkanDevice, Semaphore, Callbacks);
+        }
+    }
+
+    UploadContext::UploadContext(Device &device, VkDeviceSize ringSize) : device{device} {
+        QueueFamilyIndices indices = device.FindPhysicalQueueFamilies();
+        graphicsFamily = indices.GraphicsFamily;
+        transferFamily = indices.TransferFamily;
+
+        ring = std::make_unique<Buffer>(device,
+                                        ringSize,
+                                        1,
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                        MemoryUsage::Staging);
+        ring->Map();
+
+        if (IsTransferQueueSeparate()) {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = graphicsFamily;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_COMMAND_POOL};
+            if (vkCreateCommandPool(
+                    device.VulkanDevice, &poolInfo, device.HostCallbacks(), &acquirePool) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("Failed to create upload acquire command pool.");
+            }
+        }
+    }
+
+    UploadContext::~UploadContext() {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (auto &submission : inFlight) {
+            vkWaitForFences(device.VulkanDevice,
+                            1,
+                            &submission->Fence,
+                            VK_TRUE,
+                            std::numeric_limits<u64>::max());
+        }
+        inFlight.clear();
+
+        if (acquirePool != VK_NULL_HANDLE) {
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_COMMAND_POOL};
+            vkDestroyCommandPool(device.VulkanDevice, acquirePool, device.HostCallbacks());
+        }
+    }
+
+    bool UploadContext::AllocateStaging(VkDeviceSize size, Staging &staging) {
+        VkDeviceSize alignedSize = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+        if (alignedSize > ring->BufferSize) {
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true) {
+            RetireLocked();
+
+            VkDeviceSize offset = 0;
+            if (TryAllocateLocked(alignedSize, offset)) {
+                Region region{};
+                region.Id = nextRegion++;
+                region.Begin = offset;
+                region.End = offset + alignedSize;
+                regions.push_back(region);
+                head = region.End;
+
+                staging.Buffer = ring->VulkanBuffer;
+                staging.Offset = offset;
+                staging.Mapped = static_cast<u8 *>(ring->Mapped) + offset;
+                staging.Region = region.Id;
+                return true;
+            }
+
+            if (inFlight.empty()) {
+                return false;
+            }
+
+            // Wait for the oldest submission without blocking other threads' uploads.
+            std::shared_ptr<Submission> oldest = inFlight.front();
+            lock.unlock();
+            vkWaitForFences(
+                device.VulkanDevice, 1, &oldest->Fence, VK_TRUE, std::numeric_limits<u64>::max());
+            lock.lock();
+        }
+    }
+
+    UploadContext::Ticket UploadContext::Submit(VkCommandBuffer commandBuffer,
+                                                const std::vector<u64> &regionIds,
+                                                const std::vector<VkBufferMemoryBarrier>
+                                                    &acquires) {
+        std::lock_guard<std::mutex> lock{mutex};
+
+        auto submission = std::make_shared<Submission>(
+            device.VulkanDevice, device.HostCallbacks(), nextTicket);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        if (!IsTransferQueueSeparate()) {
+            std::lock_guard<std::mutex> queueLock{device.GetQueueMutex()};
+            if (vkQueueSubmit(device.GraphicsQueue, 1, &submitInfo, submission->Fence) !=
+                VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit upload batch.");
+            }
+        } else {
+            SubmitWithAcquire(*submission, submitInfo, acquires);
+        }
+
+        for (u64 id : regionIds) {
+            Region *region = FindRegionLocked(id);
+            region->Ticket = nextTicket;
+            region->IsSubmitted = true;
+        }
+        inFlight.push_back(std::move(submission));
+        return nextTicket++;
+    }
+
+    void UploadContext::Release(const std::vector<u64> &regionIds) {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (u64 id : regionIds) {
+            Region *region = FindRegionLocked(id);
+            region->Ticket = 0;
+            region->IsSubmitted = true;
+        }
+        RetireLocked();
+    }
+
+    bool UploadContext::IsComplete(Ticket ticket) {
+        std::lock_guard<std::mutex> lock{mutex};
+        RetireLocked();
+        return ticket <= completedTicket;
+    }
+
+    void UploadContext::Wait(Ticket ticket) {
+        std::unique_lock<std::mutex> lock{mutex};
+        while (true) {
+            RetireLocked();
+            if (ticket <= completedTicket || inFlight.empty()) {
+                return;
+            }
+
+            // Submissions retire in order, so waiting on the oldest always makes progress.
+            std::shared_ptr<Submission> oldest = inFlight.front();
+            lock.unlock();
+            vkWaitForFences(
+                device.VulkanDevice, 1, &oldest->Fence, VK_TRUE, std::numeric_limits<u64>::max());
+            lock.lock();
+        }
+    }
+
+    void UploadContext::SubmitWithAcquire(Submission &submission,
+                                          VkSubmitInfo &transferSubmit,
+                                          const std::vector<VkBufferMemoryBarrier> &acquires) {
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        {
+            HostAllocator::ObjectScope objectScope{VK_OBJECT_TYPE_SEMAPHORE};
+            if (vkCreateSemaphore(device.VulkanDevice,
+                                  &semaphoreInfo,
+                                  device.HostCallbacks(),
+                                  &submission.Semaphore) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create upload semaphore.");
+            }
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = acquirePool;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(
+                device.VulkanDevice, &allocInfo, &submission.AcquireCommands) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload acquire command buffer.");
+        }
+
+        // The acquire halves of the ownership transfers. Their source stage matches the
+        // semaphore wait below, which chains them after the copies.
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(submission.AcquireCommands, &beginInfo);
+        vkCmdPipelineBarrier(submission.AcquireCommands,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             static_cast<u32>(acquires.size()),
+                             acquires.data(),
+                             0,
+                             nullptr);
+        if (vkEndCommandBuffer(submission.AcquireCommands) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record upload acquire command buffer.");
+        }
+
+        transferSubmit.signalSemaphoreCount = 1;
+        transferSubmit.pSignalSemaphores = &submission.Semaphore;
+        std::lock_guard<std::mutex> queueLock{device.GetQueueMutex()};
+        if (vkQueueSubmit(device.TransferQueue, 1, &transferSubmit, VK_NULL_HANDLE) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload batch.");
+        }
+
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        VkSubmitInfo acquireSubmit{};
+        acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireSubmit.waitSemaphoreCount = 1;
+        acquireSubmit.pWaitSemaphores = &submission.Semaphore;
+        acquireSubmit.pWaitDstStageMask = &waitStage;
+        acquireSubmit.commandBufferCount = 1;
+        acquireSubmit.pCommandBuffers = &submission.AcquireCommands;
+        if (vkQueueSubmit(device.GraphicsQueue, 1, &acquireSubmit, submission.Fence) !=
+            VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload acquire.");
+        }
+    }
+
+    void UploadContext::RetireLocked() {
+        while (!inFlight.empty() &&
+               vkGetFenceStatus(device.VulkanDevice, inFlight.front()->Fence) == VK_SUCCESS) {
+            Submission &submission = *inFlight.front();
+            // The pool is only touched under the lock, so this cannot wait for the destructor.
+            if (submission.AcquireCommands != VK_NULL_HANDLE) {
+                vkFreeCommandBuffers(
+                    device.VulkanDevice, acquirePool, 1, &submission.AcquireCommands);
+                submission.AcquireCommands = VK_NULL_HANDLE;
+            }
+            completedTicket = submission.Ticket;
+            inFlight.pop_front();
+        }
+
+        // The ring frees in allocation order; a slice that is still being recorded holds back
+        // everything allocated after it.
+        while (!regions.empty() && regions.front().IsSubmitted &&
+               regions.front().Ticket <= completedTicket) {
+            regions.pop_front();
+        }
+    }
+
+    bool UploadContext::TryAllocateLocked(VkDeviceSize size, VkDeviceSize &offset) {
+        VkDeviceSize capacity = ring->BufferSize;
+        if (regions.empty()) {
+            head = 0;
+            offset = 0;
+            return size <= capacity;
+        }
+
+        // Live data is [tail, head), or wraps around as [tail, capacity) + [0, head). With
+        // regions live, head == tail can only mean the ring is full.
+        VkDeviceSize tail = regions.front().Begin;
+        if (head > tail) {
+            if (capacity - head >= size) {
+                offset = head;
+                return true;
+            }
+            if (tail >= size) {
+                offset = 0;
+                return true;
+            }
+            return false;
+        }
+        if (head < tail && tail - head >= size) {
+            offset = head;
+            return true;
+        }
+        return false;
+    }
+
+    UploadContext::Region *UploadContext::FindRegionLocked(u64 id) {
+        // Ids are consecutive and only ever leave from the front.
+        return &regions[static_cast<size_t>(id - regions.front().Id)];
+    }
+} // namespace XIV::Render
\ No newline at end of file
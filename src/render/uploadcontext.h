@@ -0,0 +1,115 @@
+#ifndef UPLOAD_CONTEXT_H
+#define UPLOAD_CONTEXT_H
+
+#include "buffer.h"
+#include "core.h"
+#include "device.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace XIV::Render {
+    // Owns a persistently mapped staging ring shared by every UploadBatch, and the fences that
+    // tell when a submitted batch, and the ring space it used, is done. Submissions are
+    // identified by increasing tickets, so callers can poll or wait without holding the batch.
+    //
+    // Copies run on the device's transfer queue. When that is a separate family, the written
+    // ranges are released there and acquired on the graphics queue before the ticket completes.
+    class UploadContext {
+    public:
+        static constexpr VkDeviceSize DEFAULT_RING_SIZE = 64ull * 1024 * 1024;
+        using Ticket = u64;
+
+        // A reserved slice of the ring. Region identifies it until it is submitted or released.
+        struct Staging {
+            VkBuffer Buffer = VK_NULL_HANDLE;
+            VkDeviceSize Offset = 0;
+            void *Mapped = nullptr;
+            u64 Region = 0;
+        };
+
+        UploadContext(Device &device, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+        // Waits for every submission, so nothing is still reading the ring.
+        ~UploadContext();
+        UploadContext(const UploadContext &) = delete;
+        UploadContext &operator=(const UploadContext &) = delete;
+
+        // Reserves size bytes of the ring, waiting for older submissions to retire when it is
+        // full. Returns false when the data cannot fit even then, such as when it is larger than
+        // the ring or the space is held by batches that have not been submitted yet.
+        bool AllocateStaging(VkDeviceSize size, Staging &staging);
+        // Submits a finished command buffer; regions are the ring slices its copies read. With a
+        // separate transfer family, acquires are the graphics-side halves of the ownership
+        // transfers the command buffer released.
+        Ticket Submit(VkCommandBuffer commandBuffer,
+                      const std::vector<u64> &regions,
+                      const std::vector<VkBufferMemoryBarrier> &acquires = {});
+        // Hands back slices of a batch that is dropped without being submitted.
+        void Release(const std::vector<u64> &regions);
+
+        bool IsComplete(Ticket ticket);
+        void Wait(Ticket ticket);
+
+        // Family that UploadBatch command buffers must be allocated from.
+        u32 TransferFamily() const {
+            return transferFamily;
+        }
+
+        u32 GraphicsFamily() const {
+            return graphicsFamily;
+        }
+
+        // True when copies need queue family ownership transfers.
+        bool IsTransferQueueSeparate() const {
+            return transferFamily != graphicsFamily;
+        }
+
+    private:
+        struct Region {
+            u64 Id = 0;
+            VkDeviceSize Begin = 0;
+            VkDeviceSize End = 0;
+            u64 Ticket = 0;
+            bool IsSubmitted = false;
+        };
+
+        // Destroys its fence when the last waiter lets go of it.
+        struct Submission {
+            Submission(VkDevice device, const VkAllocationCallbacks *callbacks, u64 ticket);
+            ~Submission();
+
+            VkDevice VulkanDevice = VK_NULL_HANDLE;
+            const VkAllocationCallbacks *Callbacks = nullptr;
+            u64 Ticket = 0;
+            VkFence Fence = VK_NULL_HANDLE;
+            // Only with a separate transfer family: orders the acquire after the copies.
+            VkSemaphore Semaphore = VK_NULL_HANDLE;
+            VkCommandBuffer AcquireCommands = VK_NULL_HANDLE;
+        };
+
+        void SubmitWithAcquire(Submission &submission,
+                               VkSubmitInfo &transferSubmit,
+                               const std::vector<VkBufferMemoryBarrier> &acquires);
+        void RetireLocked();
+        bool TryAllocateLocked(VkDeviceSize size, VkDeviceSize &offset);
+        Region *FindRegionLocked(u64 id);
+
+        Device &device;
+        std::unique_ptr<Buffer> ring;
+        VkDeviceSize head = 0;
+        u32 graphicsFamily = 0;
+        u32 transferFamily = 0;
+        VkCommandPool acquirePool = VK_NULL_HANDLE;
+
+        std::mutex mutex;
+        std::deque<Region> regions;
+        std::deque<std::shared_ptr<Submission>> inFlight;
+        u64 nextRegion = 1;
+        Ticket nextTicket = 1;
+        Ticket completedTicket = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "vertexwelder.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace XIV::Render {
+    // The hash and the equality test both rely on the vertex being tightly packed floats.
+    static_assert(sizeof(Model::Vertex) == 11 * sizeof(float), "Vertex must not contain padding");
+
+    VertexWelder::VertexWelder(std::vector<Model::Vertex> &vertices, size_t expectedVertexCount)
+        : vertices{vertices} {
+        // Keep the load factor at or below one half.
+        size_t capacity = 16;
+        while (capacity < 2 * std::max(expectedVertexCount, vertices.size())) {
+            capacity *= 2;
+        }
+        slots.assign(capacity, Slot{0, EMPTY_SLOT});
+        mask = capacity - 1;
+
+        for (u32 i = 0; i < static_cast<u32>(vertices.size()); ++i) {
+            u32 hash = static_cast<u32>(Hash(vertices[i]));
+            size_t slot = hash & mask;
+            while (slots[slot].Index != EMPTY_SLOT) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = Slot{hash, i};
+        }
+    }
+
+    u32 VertexWelder::Weld(const Model::Vertex &vertex) {
+        u32 hash = static_cast<u32>(Hash(vertex));
+
+        size_t slot = hash & mask;
+        while (slots[slot].Index != EMPTY_SLOT) {
+            const Slot &candidate = slots[slot];
+            if (candidate.Hash == hash &&
+                memcmp(&vertices[candidate.Index], &vertex, sizeof(Model::Vertex)) == 0) {
+                return candidate.Index;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        u32 index = static_cast<u32>(vertices.size());
+        vertices.push_back(vertex);
+        slots[slot] = Slot{hash, index};
+
+        if (2 * vertices.size() > slots.size()) {
+            Grow();
+        }
+        return index;
+    }
+
+    void VertexWelder::WeldParallel(const Model::Vertex *corners,
+                                    size_t cornerCount,
+                                    std::vector<Model::Vertex> &vertices,
+                                    std::vector<u32> &indices,
+                                    ThreadPool &pool) {
+        constexpr u32 PARTITION_BITS = 8;
+        constexpr u32 PARTITION_COUNT = 1 << PARTITION_BITS;
+
+        struct Entry {
+            u64 Hash;
+            u32 Corner;
+        };
+
+        u32 chunkCount = std::max(1u, std::min<u32>((pool.ThreadCount() + 1) * 4,
+                                                    static_cast<u32>(cornerCount / 4096 + 1)));
+        size_t chunkSize = (cornerCount + chunkCount - 1) / chunkCount;
+
+        // 1. Hash every corner and count how many land in each partition, per chunk.
+        std::vector<u64> hashes(cornerCount);
+        std::vector<size_t> offsets(static_cast<size_t>(chunkCount) * PARTITION_COUNT, 0);
+        pool.ParallelFor(chunkCount, [&](u32 chunk) {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(cornerCount, begin + chunkSize);
+            size_t *counts = &offsets[static_cast<size_t>(chunk) * PARTITION_COUNT];
+            for (size_t i = begin; i < end; ++i) {
+                hashes[i] = Hash(corners[i]);
+                ++counts[hashes[i] >> (64 - PARTITION_BITS)];
+            }
+        });
+
+        // 2. Scatter into partitions. Chunks are laid out in order within each partition, so
+        //    corners inside a partition stay sorted by corner index.
+        std::vector<size_t> partitionBegin(PARTITION_COUNT + 1, 0);
+        size_t running = 0;
+        for (u32 partition = 0; partition < PARTITION_COUNT; ++partition) {
+            partitionBegin[partition] = running;
+            for (u32 chunk = 0; chunk < chunkCount; ++chunk) {
+                size_t &offset = offsets[static_cast<size_t>(chunk) * PARTITION_COUNT + partition];
+                size_t count = offset;
+                offset = running;
+                running += count;
+            }
+        }
+        partitionBegin[PARTITION_COUNT] = running;
+
+        std::vector<Entry> entries(cornerCount);
+        pool.ParallelFor(chunkCount, [&](u32 chunk) {
+            size_t begin = chunk * chunkSize;
+            size_t end = std::min(cornerCount, begin + chunkSize);
+            size_t *cursor = &offsets[static_cast<size_t>(chunk) * PARTITION_COUNT];
+            for (size_t i = begin; i < end; ++i) {
+                entries[cursor[hashes[i] >> (64 - PARTITION_BITS)]++] =
+                    Entry{hashes[i], static_cast<u32>(i)};
+            }
+        });
+        hashes = {};
+
+        // 3. Sort each partition by hash and map every corner to the first corner it equals.
+        //    The stable sort keeps equal hashes in corner order, so the first member of a run
+        //    is always the earliest occurrence.
+        std::vector<u32> first(cornerCount);
+        pool.ParallelFor(PARTITION_COUNT, [&](u32 partition) {
+            Entry *begin = entries.data() + partitionBegin[partition];
+            Entry *end = entries.data() + partitionBegin[partition + 1];
+            std::stable_sort(begin, end, [](const Entry &a, const Entry &b) {
+                return a.Hash < b.Hash;
+            });
+
+            for (Entry *run = begin; run < end;) {
+                Entry *runEnd = run + 1;
+                while (runEnd < end && runEnd->Hash == run->Hash) {
+                    ++runEnd;
+                }
+
+                // Distinct vertices sharing a 64-bit hash are vanishingly rare, so a linear scan
+                // over the run's earlier members is fine.
+                for (Entry *entry = run; entry < runEnd; ++entry) {
+                    first[entry->Corner] = entry->Corner;
+                    for (Entry *other = run; other < entry; ++other) {
+                        if (first[other->Corner] == other->Corner &&
+                            memcmp(&corners[other->Corner],
+                                   &corners[entry->Corner],
+                                   sizeof(Model::Vertex)) == 0) {
+                            first[entry->Corner] = other->Corner;
+                            break;
+                        }
+                    }
+                }
+                run = runEnd;
+            }
+        });
+        entries = {};
+
+        // 4. Number unique vertices in first-seen order. first[i] <= i, so it has already been
+        //    replaced by its final vertex index when corner i is reached.
+        vertices.clear();
+        indices.resize(cornerCount);
+        for (size_t i = 0; i < cornerCount; ++i) {
+            if (first[i] == i) {
+                indices[i] = static_cast<u32>(vertices.size());
+                vertices.push_back(corners[i]);
+            } else {
+                indices[i] = indices[first[i]];
+            }
+        }
+    }
+
+    u64 VertexWelder::Hash(const Model::Vertex &vertex) {
+        return HashBytes(&vertex, sizeof(Model::Vertex));
+    }
+
+    void VertexWelder::Grow() {
+        std::vector<Slot> previous = std::move(slots);
+        slots.assign(previous.size() * 2, Slot{0, EMPTY_SLOT});
+        mask = slots.size() - 1;
+
+        for (const Slot &entry : previous) {
+            if (entry.Index == EMPTY_SLOT) {
+                continue;
+            }
+            size_t slot = entry.Hash & mask;
+            while (slots[slot].Index != EMPTY_SLOT) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = entry;
+        }
+    }
+} // namespace XIV::Render
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef VERTEX_WELDER_H
+#define VERTEX_WELDER_H
+
+#include "core.h"
+#include "model.h"
+#include "threadpool.h"
+
+#include <vector>
+
+namespace XIV::Render {
+    // Merges bit-identical vertices. Unlike the old std::unordered_map<Vertex, u32> this keeps
+    // a flat open-addressing table of (hash, index) slots and does a single probe sequence per
+    // input vertex. Vertices are compared bit for bit, so e.g. 0.0 and -0.0 stay distinct.
+    class VertexWelder {
+    public:
+        // Meshes with at least this many corners are welded in parallel by Builder.
+        static constexpr size_t PARALLEL_THRESHOLD = 1 << 22;
+
+        VertexWelder(std::vector<Model::Vertex> &vertices, size_t expectedVertexCount = 0);
+
+        // Returns the index of vertex, appending it to the output vertices if it is new.
+        u32 Weld(const Model::Vertex &vertex);
+
+        // Welds a whole corner list at once: hashes in parallel, radix-partitions corners by
+        // hash, sorts each partition on the pool and assigns indices in first-seen order. The
+        // result is identical to calling Weld on every corner in sequence.
+        static void WeldParallel(const Model::Vertex *corners,
+                                 size_t cornerCount,
+                                 std::vector<Model::Vertex> &vertices,
+                                 std::vector<u32> &indices,
+                                 ThreadPool &pool = ThreadPool::Shared());
+
+        static u64 Hash(const Model::Vertex &vertex);
+
+    private:
+        static constexpr u32 EMPTY_SLOT = UINT32_MAX;
+
+        struct Slot {
+            u32 Hash;
+            u32 Index;
+        };
+
+        void Grow();
+
+        std::vector<Model::Vertex> &vertices;
+        std::vector<Slot> slots;
+        size_t mask = 0;
+    };
+} // namespace XIV::Render
+
+#endif
\ No newline at end of file
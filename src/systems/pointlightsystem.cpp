@@ -5,6 +5,7 @@
 #include <array>
 #include <cassert>
 #include <map>
+#include <memory_resource>
 #include <stdexcept>
 
 namespace XIV::Systems {
@@ -15,53 +16,34 @@ namespace XIV::Systems {
     };
 
     PointLightSystem::PointLightSystem(Device &device,
+                                       PipelineBuilder &pipelineBuilder,
                                        VkRenderPass renderPass,
                                        VkDescriptorSetLayout globalSetLayout)
         : device{device} {
         CreatePipelineLayout(globalSetLayout);
-        CreatePipeline(renderPass);
-    }
-
-    PointLightSystem::~PointLightSystem() {
-        vkDestroyPipelineLayout(device.VulkanDevice, pipelineLayout, nullptr);
+        CreatePipeline(pipelineBuilder, renderPass);
     }
 
     void PointLightSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(PointLightPushConstants);
-
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(device.VulkanDevice,
-                                   &pipelineLayoutInfo,
-                                   nullptr,
-                                   &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create pipeline layout!");
-        }
+        static_assert(sizeof(PointLightPushConstants) <= LayoutCache::SHARED_PUSH_CONSTANT_SIZE);
+        pipelineLayout = device.GetLayoutCache().GetPipelineLayout(
+            {globalSetLayout}, {LayoutCache::SharedPushConstantRange()});
     }
 
-    void PointLightSystem::CreatePipeline(VkRenderPass renderPass) {
+    void PointLightSystem::CreatePipeline(PipelineBuilder &pipelineBuilder,
+                                          VkRenderPass renderPass) {
         assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-        PipelineConfigInfo pipelineConfig{};
-        Pipeline::DefaultConfigInfo(pipelineConfig);
-        Pipeline::EnableAlphaBlending(pipelineConfig);
-        pipelineConfig.AttributeDescriptions.clear();
-        pipelineConfig.BindingDescriptions.clear();
-        pipelineConfig.RenderPass = renderPass;
-        pipelineConfig.PipelineLayout = pipelineLayout;
-        pipeline = std::make_unique<Pipeline>(device,
-                                              "res/shaders/light_point.vert.spv",
-                                              "res/shaders/light_point.frag.spv",
-                                              pipelineConfig);
+        auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+        Pipeline::DefaultConfigInfo(*pipelineConfig);
+        Pipeline::EnableAlphaBlending(*pipelineConfig);
+        pipelineConfig->AttributeDescriptions.clear();
+        pipelineConfig->BindingDescriptions.clear();
+        pipelineConfig->RenderPass = renderPass;
+        pipelineConfig->PipelineLayout = pipelineLayout;
+        pipeline = pipelineBuilder.Build("res/shaders/light_point.vert.spv",
+                                         "res/shaders/light_point.frag.spv",
+                                         std::move(pipelineConfig));
     }
 
     void PointLightSystem::Update(FrameInfo &frameInfo, GlobalUbo &ubo) {
@@ -90,7 +72,7 @@ namespace XIV::Systems {
 
     void PointLightSystem::Render(FrameInfo &frameInfo) {
         // sort lights
-        std::map<float, GameObject::id_t> sorted;
+        std::pmr::map<float, GameObject::id_t> sorted{&frameInfo.Scratch};
         for (auto &kv : frameInfo.GameObjects) {
             auto &obj = kv.second;
             if (obj.PointLight == nullptr)
@@ -110,8 +92,8 @@ namespace XIV::Systems {
                                 0,
                                 1,
                                 &frameInfo.GlobalDescriptorSet,
-                                0,
-                                nullptr);
+                                1,
+                                &frameInfo.GlobalUboOffset);
 
         // iterate through sorted lights in reverse order
         for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
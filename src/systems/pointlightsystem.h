@@ -3,6 +3,7 @@
 
 #include "render/frameinfo.h"
 #include "render/pipeline.h"
+#include "render/pipelinebuilder.h"
 #include "render/device.h"
 #include "camera.h"
 #include "gameobject.h"
@@ -15,10 +16,11 @@ using namespace XIV::Render;
 namespace XIV::Systems {
     class PointLightSystem {
     public:
+        // Pipelines build in the background and are waited on the first time they are drawn.
         PointLightSystem(Device &device,
+                         PipelineBuilder &pipelineBuilder,
                          VkRenderPass renderPass,
                          VkDescriptorSetLayout globalSetLayout);
-        ~PointLightSystem();
         PointLightSystem(const PointLightSystem &) = delete;
         PointLightSystem &operator=(const PointLightSystem &) = delete;
 
@@ -27,11 +29,11 @@ namespace XIV::Systems {
 
     private:
         void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
-        void CreatePipeline(VkRenderPass renderPass);
+        void CreatePipeline(PipelineBuilder &pipelineBuilder, VkRenderPass renderPass);
 
         Device &device;
 
-        std::unique_ptr<Pipeline> pipeline;
+        PipelineHandle pipeline;
         VkPipelineLayout pipelineLayout;
     };
 } // namespace XIV::Systems
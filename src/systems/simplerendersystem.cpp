@@ -1,6 +1,8 @@
 #include "systems/simplerendersystem.h"
+#include "render/meshletbuilder.h"
 #include "wrath.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
@@ -12,54 +14,51 @@ namespace XIV::Systems {
     };
 
     SimpleRenderSystem::SimpleRenderSystem(Device &device,
+                                           PipelineBuilder &pipelineBuilder,
                                            VkRenderPass renderPass,
                                            VkDescriptorSetLayout globalSetLayout)
         : device{device} {
         CreatePipelineLayout(globalSetLayout);
-        CreatePipeline(renderPass);
-    }
-
-    SimpleRenderSystem::~SimpleRenderSystem() {
-        vkDestroyPipelineLayout(device.VulkanDevice, pipelineLayout, nullptr);
+        CreatePipeline(pipelineBuilder, renderPass);
     }
 
     void SimpleRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
-
-        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        if (vkCreatePipelineLayout(device.VulkanDevice,
-                                   &pipelineLayoutInfo,
-                                   nullptr,
-                                   &pipelineLayout) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create pipeline layout!");
-        }
+        static_assert(sizeof(SimplePushConstantData) <= LayoutCache::SHARED_PUSH_CONSTANT_SIZE);
+        pipelineLayout = device.GetLayoutCache().GetPipelineLayout(
+            {globalSetLayout}, {LayoutCache::SharedPushConstantRange()});
     }
 
-    void SimpleRenderSystem::CreatePipeline(VkRenderPass renderPass) {
+    void SimpleRenderSystem::CreatePipeline(PipelineBuilder &pipelineBuilder,
+                                            VkRenderPass renderPass) {
         assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-        PipelineConfigInfo pipelineConfig{};
-        Pipeline::DefaultConfigInfo(pipelineConfig);
-        pipelineConfig.RenderPass = renderPass;
-        pipelineConfig.PipelineLayout = pipelineLayout;
-        pipeline = std::make_unique<Pipeline>(device,
-                                              "res/shaders/simple.vert.spv",
-                                              "res/shaders/simple.frag.spv",
-                                              pipelineConfig);
+        // Heap-allocated, since the configs point into themselves and outlive this call.
+        auto pipelineConfig = std::make_unique<PipelineConfigInfo>();
+        Pipeline::DefaultConfigInfo(*pipelineConfig);
+        pipelineConfig->RenderPass = renderPass;
+        pipelineConfig->PipelineLayout = pipelineLayout;
+        // Cone culling only removes faces the rasterizer would drop anyway.
+        isConeCullingEnabled =
+            pipelineConfig->RasterizationInfo.cullMode == VK_CULL_MODE_BACK_BIT;
+        pipeline = pipelineBuilder.Build("res/shaders/simple.vert.spv",
+                                         "res/shaders/simple.frag.spv",
+                                         std::move(pipelineConfig));
+
+        auto compactPipelineConfig = std::make_unique<PipelineConfigInfo>();
+        Pipeline::DefaultConfigInfo(*compactPipelineConfig, VertexFormat::Compact);
+        compactPipelineConfig->RenderPass = renderPass;
+        compactPipelineConfig->PipelineLayout = pipelineLayout;
+        compactPipeline = pipelineBuilder.Build("res/shaders/simple_compact.vert.spv",
+                                                "res/shaders/simple.frag.spv",
+                                                std::move(compactPipelineConfig));
     }
 
     void SimpleRenderSystem::RenderGameObjects(FrameInfo &frameInfo) {
         pipeline->Bind(frameInfo.CommandBuffer);
+        VertexFormat boundFormat = VertexFormat::Full;
+        // Pooled models share buffers, so most objects reuse the previous object's bindings.
+        VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+        VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
 
         vkCmdBindDescriptorSets(frameInfo.CommandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -67,8 +66,8 @@ namespace XIV::Systems {
                                 0,
                                 1,
                                 &frameInfo.GlobalDescriptorSet,
-                                0,
-                                nullptr);
+                                1,
+                                &frameInfo.GlobalUboOffset);
 
         for (auto &kv : frameInfo.GameObjects) {
             // Get the object from the map and check for the model.
@@ -77,8 +76,16 @@ namespace XIV::Systems {
                 continue;
             }
 
+            if (obj.Model->Format() != boundFormat) {
+                boundFormat = obj.Model->Format();
+                PipelineHandle &formatPipeline =
+                    boundFormat == VertexFormat::Compact ? compactPipeline : pipeline;
+                formatPipeline->Bind(frameInfo.CommandBuffer);
+            }
+
+            // Quantized positions are expanded back to object space by the model matrix.
             SimplePushConstantData push{};
-            push.ModelMatrix = obj.Transform.Matrix4();
+            push.ModelMatrix = obj.Transform.Matrix4() * obj.Model->DequantizationMatrix();
             push.NormalMatrix = obj.Transform.NormalMatrix();
             vkCmdPushConstants(frameInfo.CommandBuffer,
                                pipelineLayout,
@@ -86,8 +93,116 @@ namespace XIV::Systems {
                                0,
                                sizeof(SimplePushConstantData),
                                &push);
-            obj.Model->Bind(frameInfo.CommandBuffer);
-            obj.Model->Draw(frameInfo.CommandBuffer);
+            obj.LodLevel = SelectLod(obj, frameInfo.Camera);
+            if (obj.Model->VertexBuffer() != boundVertexBuffer ||
+                obj.Model->IndexBuffer() != boundIndexBuffer) {
+                boundVertexBuffer = obj.Model->VertexBuffer();
+                boundIndexBuffer = obj.Model->IndexBuffer();
+                obj.Model->Bind(frameInfo.CommandBuffer);
+            }
+            if (obj.Model->Meshlets().empty()) {
+                obj.Model->Draw(frameInfo.CommandBuffer, obj.LodLevel);
+            } else {
+                DrawMeshlets(frameInfo, obj);
+            }
+        }
+    }
+
+    void SimpleRenderSystem::DrawMeshlets(FrameInfo &frameInfo, GameObject &obj) {
+        Model &model = *obj.Model;
+        const Model::Lod &lod = model.GetLod(obj.LodLevel);
+        Mat4 modelMatrix = obj.Transform.Matrix4();
+
+        // Frustum planes in object space, from the rows of the clip matrix (depth is 0..1).
+        Mat4 clip = frameInfo.Camera.ProjectionMatrix * frameInfo.Camera.ViewMatrix * modelMatrix;
+        auto row = [&clip](int r) { return Vec4{clip[0][r], clip[1][r], clip[2][r], clip[3][r]}; };
+        Vec4 planes[6] = {row(3) + row(0),
+                          row(3) - row(0),
+                          row(3) + row(1),
+                          row(3) - row(1),
+                          row(2),
+                          row(3) - row(2)};
+        for (Vec4 &plane : planes) {
+            plane = plane / Wrath::Length(Vec3(plane));
+        }
+
+        auto isInFrustum = [&planes](const Model::Meshlet &meshlet) {
+            for (const Vec4 &plane : planes) {
+                if (Wrath::Dot(Vec3(plane), meshlet.Center) + plane.w < -meshlet.Radius) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Normal cones do not survive non-uniform scaling.
+        const Vec3 &scale = obj.Transform.Scale;
+        bool isConeCulled = isConeCullingEnabled && scale.x == scale.y && scale.y == scale.z;
+        Vec3 viewer{0.0f};
+        if (isConeCulled) {
+            viewer = Vec3(Wrath::Inverse(modelMatrix) * Vec4(frameInfo.Camera.GetPosition(), 1.0f));
+        }
+
+        // Neighboring visible meshlets are contiguous in the index buffer, so they share a draw.
+        u32 runFirst = 0;
+        u32 runCount = 0;
+        auto flush = [&]() {
+            if (runCount > 0) {
+                model.DrawRange(frameInfo.CommandBuffer, runFirst, runCount);
+                runCount = 0;
+            }
+        };
+
+        const std::vector<Model::Meshlet> &meshlets = model.Meshlets();
+        for (u32 i = lod.FirstMeshlet; i < lod.FirstMeshlet + lod.MeshletCount; ++i) {
+            const Model::Meshlet &meshlet = meshlets[i];
+            bool isVisible = isInFrustum(meshlet) &&
+                             !(isConeCulled && MeshletBuilder::IsBackfacing(meshlet, viewer));
+            if (!isVisible) {
+                flush();
+                continue;
+            }
+
+            if (runCount > 0 && runFirst + runCount != meshlet.FirstIndex) {
+                flush();
+            }
+            if (runCount == 0) {
+                runFirst = meshlet.FirstIndex;
+            }
+            runCount += meshlet.IndexCount;
+        }
+        flush();
+    }
+
+    u32 SimpleRenderSystem::SelectLod(GameObject &obj, const Camera &camera) {
+        const Model &model = *obj.Model;
+        if (model.LodCount() == 1) {
+            return 0;
+        }
+
+        // Project each level's object-space error at the distance of the nearest bound.
+        const Vec3 &scale = obj.Transform.Scale;
+        float maxScale = std::max({Wrath::Abs(scale.x), Wrath::Abs(scale.y), Wrath::Abs(scale.z)});
+        Vec3 center = Vec3(obj.Transform.Matrix4() * Vec4(model.BoundsCenter(), 1.0f));
+        float distance = Wrath::Length(center - camera.GetPosition()) -
+                         model.BoundsRadius() * maxScale;
+        if (distance <= 0.0f) {
+            return 0;
+        }
+
+        float projection = Wrath::Abs(camera.ProjectionMatrix[1][1]) * maxScale / distance;
+        auto screenError = [&model, projection](u32 lod) {
+            return model.GetLod(lod).Error * projection;
+        };
+
+        u32 lod = std::min(obj.LodLevel, model.LodCount() - 1);
+        while (lod > 0 && screenError(lod) > LOD_ERROR_THRESHOLD) {
+            --lod;
+        }
+        while (lod + 1 < model.LodCount() &&
+               screenError(lod + 1) < LOD_ERROR_THRESHOLD * LOD_HYSTERESIS) {
+            ++lod;
         }
+        return lod;
     }
 } // namespace XIV::Systems
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "render/device.h"
 #include "render/frameinfo.h"
 #include "render/pipeline.h"
+#include "render/pipelinebuilder.h"
 #include "gameobject.h"
 #include "camera.h"
 
@@ -15,23 +16,38 @@ using namespace XIV::Render;
 namespace XIV::Systems {
     class SimpleRenderSystem {
     public:
+        // Pipelines build in the background and are waited on the first time they are drawn.
         SimpleRenderSystem(Device &device,
+                           PipelineBuilder &pipelineBuilder,
                            VkRenderPass renderPass,
                            VkDescriptorSetLayout globalSetLayout);
-        ~SimpleRenderSystem();
         SimpleRenderSystem(const SimpleRenderSystem &) = delete;
         SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
+        // A coarser LOD is used while its error covers less than this much of the screen, in NDC
+        // units (2 spans the viewport height; 0.003 is about a pixel at 600 lines).
+        static constexpr float LOD_ERROR_THRESHOLD = 0.003f;
+        // Moving to a coarser LOD needs the error to fall this far below the threshold, so
+        // objects near a switching distance do not flicker between levels.
+        static constexpr float LOD_HYSTERESIS = 0.75f;
+
         void RenderGameObjects(FrameInfo &frameInfo);
 
     private:
+        static u32 SelectLod(GameObject &obj, const Camera &camera);
+        // Culls the object's meshlets against the frustum (and their normal cones when back
+        // faces are culled anyway) and draws the survivors in as few ranges as possible.
+        void DrawMeshlets(FrameInfo &frameInfo, GameObject &obj);
+
         void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
-        void CreatePipeline(VkRenderPass renderPass);
+        void CreatePipeline(PipelineBuilder &pipelineBuilder, VkRenderPass renderPass);
 
         Device &device;
 
-        std::unique_ptr<Pipeline> pipeline;
+        PipelineHandle pipeline;
+        PipelineHandle compactPipeline;
         VkPipelineLayout pipelineLayout;
+        bool isConeCullingEnabled = false;
     };
 } // namespace XIV::Systems
 
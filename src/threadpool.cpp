@@ -0,0 +1,122 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace XIV {
+    ThreadPool::ThreadPool(u32 threadCount) {
+        if (threadCount == 0) {
+            u32 hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+        }
+
+        workers.reserve(threadCount);
+        for (u32 i = 0; i < threadCount; ++i) {
+            workers.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            isStopping = true;
+        }
+        condition.notify_all();
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool &ThreadPool::Shared() {
+        static ThreadPool pool{};
+        return pool;
+    }
+
+    void ThreadPool::ParallelFor(u32 count, const std::function<void(u32)> &fn) {
+        if (count == 0) {
+            return;
+        }
+
+        if (count == 1 || workers.empty()) {
+            for (u32 i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        // Helpers may be dequeued after this call returns, so everything they touch is shared.
+        // They only dereference fn after successfully claiming an index, which cannot happen
+        // once the caller has seen every index complete.
+        struct State {
+            std::atomic<u32> next{0};
+            std::atomic<u32> finished{0};
+            u32 count = 0;
+            const std::function<void(u32)> *fn = nullptr;
+            std::mutex mutex;
+            std::condition_variable condition;
+            std::exception_ptr error;
+        };
+
+        auto state = std::make_shared<State>();
+        state->count = count;
+        state->fn = &fn;
+
+        auto drain = [](State &s) {
+            for (u32 i = s.next.fetch_add(1); i < s.count; i = s.next.fetch_add(1)) {
+                try {
+                    (*s.fn)(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock{s.mutex};
+                    if (!s.error) {
+                        s.error = std::current_exception();
+                    }
+                }
+
+                if (s.finished.fetch_add(1) + 1 == s.count) {
+                    std::lock_guard<std::mutex> lock{s.mutex};
+                    s.condition.notify_all();
+                }
+            }
+        };
+
+        u32 helperCount = std::min(ThreadCount(), count - 1);
+        for (u32 i = 0; i < helperCount; ++i) {
+            Enqueue([state, drain]() { drain(*state); });
+        }
+
+        drain(*state);
+
+        std::unique_lock<std::mutex> lock{state->mutex};
+        state->condition.wait(lock, [&state]() { return state->finished.load() == state->count; });
+
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            jobs.push_back(std::move(job));
+        }
+        condition.notify_one();
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                condition.wait(lock, [this]() { return isStopping || !jobs.empty(); });
+                if (isStopping && jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+} // namespace XIV
\ No newline at end of file
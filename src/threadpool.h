@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "core.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace XIV {
+    class ThreadPool {
+    public:
+        // threadCount == 0 picks one worker per hardware thread, minus the calling thread.
+        explicit ThreadPool(u32 threadCount = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Process-wide pool shared by asset loading and other background work.
+        static ThreadPool &Shared();
+
+        template <typename F> auto Submit(F &&task) -> std::future<std::invoke_result_t<F>> {
+            using Result = std::invoke_result_t<F>;
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> future = packaged->get_future();
+            Enqueue([packaged]() { (*packaged)(); });
+            return future;
+        }
+
+        // Runs fn(i) for every i in [0, count). The calling thread takes part and only waits on
+        // work that has actually started, so it is safe to call from inside a pool job.
+        // The first exception thrown by fn is rethrown on the calling thread.
+        void ParallelFor(u32 count, const std::function<void(u32)> &fn);
+
+        u32 ThreadCount() const {
+            return static_cast<u32>(workers.size());
+        }
+
+    private:
+        void Enqueue(std::function<void()> job);
+        void WorkerLoop();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool isStopping = false;
+    };
+} // namespace XIV
+
+#endif
\ No newline at end of file
@@ -1,6 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include "core.h"
+
+#include <cstring>
 #include <functional>
 
 namespace XIV {
@@ -10,6 +13,41 @@ namespace XIV {
         seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
         (HashCombine(seed, rest), ...);
     };
+
+    inline u64 RotateLeft(u64 x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // 64-bit content hash that consumes 8 bytes per step (xxHash64-style mixing).
+    // Not cryptographic: meant for cache keys and staleness checks on large blobs.
+    inline u64 HashBytes(const void *data, size_t size, u64 seed = 0) {
+        constexpr u64 P1 = 0x9E3779B185EBCA87ull;
+        constexpr u64 P2 = 0xC2B2AE3D27D4EB4Full;
+        constexpr u64 P3 = 0x165667B19E3779F9ull;
+        constexpr u64 P4 = 0x85EBCA77C2B2AE63ull;
+
+        const u8 *bytes = static_cast<const u8 *>(data);
+        u64 hash = seed + P3 + static_cast<u64>(size);
+
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            u64 word;
+            memcpy(&word, bytes + i, sizeof(word));
+            hash ^= RotateLeft(word * P2, 31) * P1;
+            hash = RotateLeft(hash, 27) * P1 + P4;
+        }
+        for (; i < size; ++i) {
+            hash ^= bytes[i] * P3;
+            hash = RotateLeft(hash, 11) * P1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= P2;
+        hash ^= hash >> 29;
+        hash *= P3;
+        hash ^= hash >> 32;
+        return hash;
+    }
 } // namespace XIV
 
 #endif
\ No newline at end of file
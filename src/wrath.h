@@ -76,6 +76,10 @@ namespace XIV {
             return glm::normalize(x);
         }
 
+        static float Length(Vec3 x) {
+            return glm::length(x);
+        }
+
         static float Dot(Vec3 x, Vec3 y) {
             return glm::dot(x, y);
         }
@@ -88,6 +92,10 @@ namespace XIV {
         static Mat4 Rotate(Mat4 mat, float angle, Vec3 axis) {
             return glm::rotate(mat, angle, axis);
         }
+
+        static Mat4 Inverse(const Mat4 &mat) {
+            return glm::inverse(mat);
+        }
     };
 } // namespace XIV
 